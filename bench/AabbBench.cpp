@@ -0,0 +1,147 @@
+/*
+PROGRAM: Brick Breakers Using SDL
+PART: Benchmark for the batched box kernel. Checks every version bit for
+      bit against checkCollision, edge cases included, then times them
+      against calling checkCollision once per brick.
+
+      g++ -O2 -I.. AabbBench.cpp ../core/[A-Z]*.cpp -o aabb_bench
+*/
+#include <stdio.h>
+#include <stdint.h>
+#include <chrono>
+#include <vector>
+
+#include "core/Game.h"
+#include "core/AabbBatch.h"
+
+//Same little generator everywhere so runs are repeatable
+static uint32_t nextRandom(uint32_t& state)
+{
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+	return state;
+}
+
+static double secondsSince(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+//Runs one version against checkCollision on every box, returns false on any difference
+static bool validate(const char* name, OverlapBatchFunction kernel, const std::vector<Rect>& balls,
+	const std::vector<int>& posX, const std::vector<int>& posY, int width, int height)
+{
+	std::vector<uint64_t> hits;
+	for (size_t count = 0; count <= posX.size(); count += (count < 80 ? 1 : 997))
+	{
+		hits.assign((count + 63) / 64 + 1, ~(uint64_t)0);
+		for (size_t b = 0; b < balls.size(); b++)
+		{
+			int total = kernel(balls[b], &posX[0], &posY[0], width, height, count, &hits[0]);
+			int expected = 0;
+			for (size_t i = 0; i < count; i++)
+			{
+				Rect brick = { posX[i], posY[i], width, height };
+				bool hit = checkCollision(balls[b], brick);
+				expected += hit;
+				if (hit != (((hits[i >> 6] >> (i & 63)) & 1) != 0))
+				{
+					printf("%s: brick %d of %d differs from checkCollision\n", name, (int)i, (int)count);
+					return false;
+				}
+			}
+
+			//Bits past the last brick in its word have to be clear too
+			if (count % 64 != 0 && (hits[count >> 6] >> (count & 63)) != 0)
+			{
+				printf("%s: stray bits past brick %d\n", name, (int)count);
+				return false;
+			}
+			if (total != expected)
+			{
+				printf("%s: counted %d hits, checkCollision found %d\n", name, total, expected);
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+int main()
+{
+	const int brickCount = 4096;
+	const int width = 50, height = 25;
+
+	//Bricks on a coarse grid so plenty of them share edges with the balls
+	uint32_t seed = 2015;
+	std::vector<int> posX(brickCount), posY(brickCount);
+	for (int i = 0; i < brickCount; i++)
+	{
+		posX[i] = (int)(nextRandom(seed) % 80) * 5 - 50;
+		posY[i] = (int)(nextRandom(seed) % 60) * 5 - 25;
+	}
+
+	//Balls that touch, overlap and miss, plus flat and inside out ones
+	std::vector<Rect> balls;
+	for (int i = 0; i < 256; i++)
+		balls.push_back({ (int)(nextRandom(seed) % 80) * 5 - 50, (int)(nextRandom(seed) % 60) * 5 - 25, 20, 20 });
+	balls.push_back({ 0, 0, 0, 0 });
+	balls.push_back({ 10, 10, -5, 20 });
+	balls.push_back({ 0, 0, width, height });
+	balls.push_back({ -10000, -10000, 20000, 20000 });
+
+	struct Version
+	{
+		const char* name;
+		OverlapBatchFunction kernel;
+	};
+	Version versions[] = {
+		{ "scalar", overlapBatchScalar() },
+		{ "sse2", overlapBatchSSE2() },
+		{ "avx2", overlapBatchAVX2() }
+	};
+
+	for (const Version& version : versions)
+	{
+		if (version.kernel == NULL)
+			printf("%-8s not available on this build or CPU\n", version.name);
+		else if (!validate(version.name, version.kernel, balls, posX, posY, width, height))
+			return 1;
+	}
+	printf("All versions match checkCollision bit for bit, overlapBatch uses %s\n\n", overlapBatchName());
+
+	//Throughput, one ball against every brick, over and over
+	const int passes = 20000;
+	std::vector<uint64_t> hits((brickCount + 63) / 64);
+	long long sink = 0;
+
+	auto start = std::chrono::steady_clock::now();
+	for (int pass = 0; pass < passes; pass++)
+	{
+		const Rect& ball = balls[pass % 256];
+		for (int i = 0; i < brickCount; i++)
+		{
+			Rect brick = { posX[i], posY[i], width, height };
+			sink += checkCollision(ball, brick);
+		}
+	}
+	double baseline = passes * (double)brickCount / secondsSince(start) / 1e6;
+	printf("%-16s %10.0f Mboxes/s\n", "checkCollision", baseline);
+
+	for (const Version& version : versions)
+	{
+		if (version.kernel == NULL)
+			continue;
+
+		start = std::chrono::steady_clock::now();
+		for (int pass = 0; pass < passes; pass++)
+			sink += version.kernel(balls[pass % 256], &posX[0], &posY[0], width, height, brickCount, &hits[0]);
+		double rate = passes * (double)brickCount / secondsSince(start) / 1e6;
+		printf("%-16s %10.0f Mboxes/s %6.1fx\n", version.name, rate, rate / baseline);
+	}
+
+	if (sink == 42)
+		printf("\n");
+	return 0;
+}
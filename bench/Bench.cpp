@@ -0,0 +1,307 @@
+/*
+PROGRAM: Brick Breakers Using SDL
+PART: Headless game benchmark. Plays the rules without a window for a
+      set number of steps with a given number of bricks and balls, and
+      prints one JSON object: steps per second, nanoseconds per
+      collision test and heap allocations per step. The same arguments
+      always play the same game.
+
+      The collision tests are timed on their own, away from the rest of
+      the step: the fast pass over balls out in the open, and the
+      broadphase plus swept box tests of balls among the bricks, each on
+      a fixed set of moves. ns_per_collision_test weighs the two by how
+      many of each the game did.
+
+      g++ -O2 -I.. Bench.cpp ../core/[A-Z]*.cpp -o bench
+      ./bench --bricks 10000 --balls 1000 --ticks 5000
+*/
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <new>
+#include <vector>
+
+#include "core/AabbBatch.h"
+#include "core/BallSet.h"
+#include "core/Game.h"
+#include "core/Random.h"
+#include "core/Sweep.h"
+
+//Every heap allocation the program makes, counted by the operators below
+static std::atomic<unsigned long long> gAllocations(0);
+
+void* operator new(size_t size)
+{
+	gAllocations++;
+	void* memory = malloc(size > 0 ? size : 1);
+	if (memory == NULL)
+		throw std::bad_alloc();
+	return memory;
+}
+
+void* operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+	gAllocations++;
+	return malloc(size > 0 ? size : 1);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+	return operator new(size, std::nothrow);
+}
+
+void operator delete(void* memory) noexcept
+{
+	free(memory);
+}
+
+void operator delete[](void* memory) noexcept
+{
+	free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept
+{
+	free(memory);
+}
+
+void operator delete[](void* memory, size_t) noexcept
+{
+	free(memory);
+}
+
+//What to play
+struct BenchConfig
+{
+	int bricks = 1000;
+	int balls = 100;
+	int ticks = 5000;
+	int warmup = 120;
+	int health = 1;
+	int tickRate = DEFAULT_TICK_RATE;
+	unsigned int seed = 1;
+};
+
+//Fills the top of the screen with count bricks in even rows. The bricks
+// shrink as the count grows so they all stay where the balls can reach.
+static void buildLayout(BrickLayout& layout, int count, int health)
+{
+	const int fieldX = 0, fieldY = 40, fieldWidth = SCREEN_WIDTH, fieldHeight = 300;
+
+	int columns = 1;
+	while (columns < fieldWidth && (long long)columns * columns * fieldHeight < (long long)count * fieldWidth)
+		columns++;
+	int rows = (count + columns - 1) / columns;
+	int stepX = fieldWidth / columns > 0 ? fieldWidth / columns : 1;
+	int stepY = fieldHeight / rows > 0 ? fieldHeight / rows : 1;
+
+	layout.clear();
+	layout.brickWidth = stepX > 1 ? stepX * 3 / 4 : 1;
+	layout.brickHeight = stepY > 1 ? stepY * 3 / 4 : 1;
+	for (int i = 0; i < count; i++)
+		layout.addBrick(fieldX + (i % columns) * stepX, fieldY + (i / columns) * stepY, (unsigned char)((i / columns) % 3), (unsigned char)health);
+	layout.finish();
+}
+
+//Keys that keep the paddle under the first ball and start a new game
+// whenever the last one ended
+static Input pickInput(const GameState& state, unsigned int tick)
+{
+	Input input;
+	if (state.mode != GAMEMODE::PLAY)
+	{
+		//Space has to be let go of between presses
+		input.keys = (tick & 1) ? KEY_SPACE : 0;
+		return input;
+	}
+
+	if (state.balls.size() > 0)
+	{
+		float ballCenter = state.balls.x[0] + Ball::BALL_SIZE / 2.0f;
+		float paddleCenter = state.paddle.mPosX + Paddle::PLAYER_WIDTH / 2.0f;
+		if (ballCenter < paddleCenter - 4.0f)
+			input.keys |= KEY_LEFT;
+		else if (ballCenter > paddleCenter + 4.0f)
+			input.keys |= KEY_RIGHT;
+	}
+	return input;
+}
+
+//Nanoseconds per test of each kind the game counts
+struct CollisionTiming
+{
+	double nsPerFastMove = 0.0;
+	double nsPerSweepTest = 0.0;
+};
+
+static double secondsSince(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+//Times the collision tests on a fixed workload with the game's layout,
+// ball count and step length, the same way every run
+static CollisionTiming timeCollisions(const BrickLayout& layout, int ballCount, int tickRate, unsigned int seed)
+{
+	CollisionTiming timing;
+	const float dt = 1.0f / tickRate;
+	const float size = (float)Ball::BALL_SIZE;
+	const float distance = Ball::BALL_SPEED * dt;
+	Rect bounds = layout.index.getBounds();
+	Random random(seed);
+
+	//The fast pass: balls between the bricks and the paddle, flying
+	// nearly level and put back every few steps so they stay out in the open
+	BallSet balls;
+	for (int i = 0; i < ballCount; i++)
+	{
+		float angle = random.range(-0.05f, 0.05f);
+		balls.add(random.range(0.0f, SCREEN_WIDTH - size), random.range((float)(bounds.y + bounds.h) + 2.0f * size, SCREEN_HEIGHT - 4.0f * size),
+			Ball::BALL_SPEED * cosf(angle) * (i & 1 ? 1.0f : -1.0f), Ball::BALL_SPEED * sinf(angle));
+	}
+	BallSet start = balls;
+	std::vector<unsigned char> flags(ballCount);
+	const int steps = 256;
+	int rounds = 2000000 / (ballCount * steps) + 1;
+	double seconds = 0.0;
+	for (int round = 0; round < rounds; round++)
+	{
+		balls.x = start.x;
+		balls.y = start.y;
+		auto begin = std::chrono::steady_clock::now();
+		for (int step = 0; step < steps; step++)
+			integrateBalls(balls, dt, bounds, (float)SCREEN_HEIGHT, &flags[0]);
+		seconds += secondsSince(begin);
+	}
+	timing.nsPerFastMove = seconds * 1e9 / ((double)rounds * steps * ballCount);
+
+	//The exact pass: moves starting among the bricks in every direction,
+	// each one queried from the broadphase and swept against what it hands over
+	const int moveCount = 4096;
+	std::vector<float> moveX(moveCount), moveY(moveCount), moveDx(moveCount), moveDy(moveCount);
+	for (int i = 0; i < moveCount; i++)
+	{
+		float angle = random.range(0.0f, 6.2831853f);
+		moveX[i] = random.range((float)bounds.x, (float)(bounds.x + bounds.w) - size);
+		moveY[i] = random.range((float)bounds.y, (float)(bounds.y + bounds.h) - size);
+		moveDx[i] = distance * cosf(angle);
+		moveDy[i] = distance * sinf(angle);
+	}
+	std::vector<int> nearby;
+	SweepHit hit;
+	unsigned long long tests = 0, touched = 0;
+	rounds = 20;
+	auto begin = std::chrono::steady_clock::now();
+	for (int round = 0; round < rounds; round++)
+	{
+		for (int i = 0; i < moveCount; i++)
+		{
+			layout.index.query(sweptBounds(moveX[i], moveY[i], size, size, moveDx[i], moveDy[i]), nearby);
+			for (size_t j = 0; j < nearby.size(); j++)
+			{
+				Rect brick = { layout.posX[nearby[j]], layout.posY[nearby[j]], layout.brickWidth, layout.brickHeight };
+				touched += sweepBox(moveX[i], moveY[i], size, size, moveDx[i], moveDy[i], brick, hit);
+			}
+			tests += nearby.size();
+		}
+	}
+	seconds = secondsSince(begin);
+
+	//Keeps the tests from being optimized away
+	if (touched == ~0ull)
+		printf("\n");
+	timing.nsPerSweepTest = tests > 0 ? seconds * 1e9 / tests : 0.0;
+	return timing;
+}
+
+static bool readInt(int argc, char* args[], int& i, const char* name, int& value)
+{
+	if (strcmp(args[i], name) != 0 || i + 1 >= argc)
+		return false;
+	value = atoi(args[++i]);
+	return true;
+}
+
+int main(int argc, char* args[])
+{
+	BenchConfig config;
+	for (int i = 1; i < argc; i++)
+	{
+		int seed;
+		if (readInt(argc, args, i, "--bricks", config.bricks) || readInt(argc, args, i, "--balls", config.balls)
+			|| readInt(argc, args, i, "--ticks", config.ticks) || readInt(argc, args, i, "--warmup", config.warmup)
+			|| readInt(argc, args, i, "--health", config.health) || readInt(argc, args, i, "--tick-rate", config.tickRate))
+			continue;
+		if (readInt(argc, args, i, "--seed", seed))
+		{
+			config.seed = (unsigned int)seed;
+			continue;
+		}
+		printf("Usage: %s [--bricks N] [--balls N] [--ticks N] [--warmup N] [--health 1-255] [--tick-rate N] [--seed N]\n", args[0]);
+		return 1;
+	}
+	if (config.bricks < 1 || config.balls < 1 || config.ticks < 1 || config.warmup < 0
+		|| config.health < 1 || config.health > 255 || config.tickRate < 1)
+	{
+		printf("Every count has to be positive and the health 1 to 255\n");
+		return 1;
+	}
+
+	BrickLayout layout;
+	buildLayout(layout, config.bricks, config.health);
+
+	GameConfig gameConfig;
+	gameConfig.tickRate = config.tickRate;
+	gameConfig.layout = &layout;
+	gameConfig.ballCount = config.balls;
+	gameConfig.seed = config.seed;
+	gameConfig.floorBounces = true;
+	Game game(gameConfig);
+
+	//Get past the menu and let the buffers grow to their working size
+	unsigned int tick = 0;
+	for (int i = 0; i < config.warmup || game.getState().mode != GAMEMODE::PLAY; i++, tick++)
+		game.step(pickInput(game.getState(), tick));
+	game.resetStats();
+
+	int restarts = 0;
+	unsigned long long allocationsBefore = gAllocations;
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < config.ticks; i++, tick++)
+	{
+		GAMEMODE mode = game.getState().mode;
+		game.step(pickInput(game.getState(), tick));
+		if (mode != GAMEMODE::PLAY && game.getState().mode == GAMEMODE::PLAY)
+			restarts++;
+	}
+	double seconds = secondsSince(start);
+	unsigned long long allocations = gAllocations - allocationsBefore;
+
+	//A collision test is one ball checked by the fast pass or one swept box
+	// test, each costed on its own and weighed by how many the game did
+	const GameStats& stats = game.getStats();
+	unsigned long long tests = stats.fastMoves + stats.sweepTests;
+	CollisionTiming timing = timeCollisions(layout, config.balls, config.tickRate, config.seed);
+	double collisionNs = tests > 0 ? (stats.fastMoves * timing.nsPerFastMove + stats.sweepTests * timing.nsPerSweepTest) / tests : 0.0;
+	const GameState& state = game.getState();
+
+	printf("{\"bench\": \"game\", \"bricks\": %d, \"balls\": %d, \"ticks\": %d, \"warmup\": %d, \"health\": %d, \"tick_rate\": %d, \"seed\": %u, "
+		"\"overlap_kernel\": \"%s\", \"seconds\": %.6f, \"ticks_per_sec\": %.1f, \"play_ticks\": %llu, \"restarts\": %d, "
+		"\"collision_tests\": %llu, \"fast_moves\": %llu, \"sweep_tests\": %llu, \"brick_candidates\": %llu, "
+		"\"ns_per_fast_move\": %.3f, \"ns_per_sweep_test\": %.3f, \"ns_per_collision_test\": %.3f, "
+		"\"allocations\": %llu, \"allocations_per_tick\": %.4f, \"final_score\": %d, \"final_balls\": %zu, \"final_bricks\": %d}\n",
+		config.bricks, config.balls, config.ticks, config.warmup, config.health, config.tickRate, config.seed,
+		overlapBatchName(), seconds, config.ticks / seconds, (unsigned long long)stats.playSteps, restarts,
+		tests, (unsigned long long)stats.fastMoves, (unsigned long long)stats.sweepTests, (unsigned long long)stats.brickCandidates,
+		timing.nsPerFastMove, timing.nsPerSweepTest, collisionNs,
+		allocations, (double)allocations / config.ticks, state.score, state.balls.size(), state.bricks.getAliveCount());
+	return 0;
+}
@@ -0,0 +1,132 @@
+/*
+PROGRAM: Brick Breakers Using SDL
+PART: Broadphase benchmark. Times ball-versus-brick lookups through the
+      brick index against testing every brick, for walls of 24 up to
+      100,000 bricks. The index keeps the bricks tested per ball to a
+      few, but the cost per ball still grows with the wall: a ball
+      among dense bricks has more of them around it, and balls scattered
+      over a big wall miss the cache on every lookup. The in order
+      column looks the same balls up row by row, to tell the two apart.
+
+      g++ -O2 -I.. BroadphaseBench.cpp ../core/[A-Z]*.cpp -o broadphase_bench
+*/
+#include <stdio.h>
+#include <stdint.h>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#include "core/Game.h"
+
+//Same little generator everywhere so runs are repeatable
+static uint32_t nextRandom(uint32_t& state)
+{
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+	return state;
+}
+
+static double secondsSince(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main()
+{
+	const int brickCounts[] = { 24, 1000, 10000, 100000 };
+	const int queries = 200000;
+
+	printf("%10s %14s %16s %12s %14s %10s\n", "bricks", "index ns/ball", "in order ns/ball", "candidates", "brute ns/ball", "speedup");
+
+	for (int brickCount : brickCounts)
+	{
+		//Rows as wide as the classic wall for small counts, wider for big ones
+		int columns = brickCount < 200 ? 8 : 200;
+		BrickLayout layout;
+		layout.addRows(brickCount, columns, 100, 80, 65, 40);
+		layout.finish();
+
+		int fieldWidth = 100 + columns * 65;
+		int fieldHeight = 80 + (brickCount / columns + 1) * 40;
+
+		//Ball positions scattered over the wall
+		uint32_t seed = 12345;
+		std::vector<Rect> balls(queries);
+		for (int i = 0; i < queries; i++)
+			balls[i] = { (int)(nextRandom(seed) % fieldWidth), (int)(nextRandom(seed) % fieldHeight), Ball::BALL_SIZE, Ball::BALL_SIZE };
+
+		//Broadphase, then the exact test on whatever it hands back
+		std::vector<int> nearby;
+		nearby.reserve(64);
+		long long candidates = 0;
+		long long hits = 0;
+		auto start = std::chrono::steady_clock::now();
+		for (int i = 0; i < queries; i++)
+		{
+			layout.index.query(balls[i], nearby);
+			candidates += nearby.size();
+			for (size_t n = 0; n < nearby.size(); n++)
+			{
+				Rect brick = { layout.posX[nearby[n]], layout.posY[nearby[n]], layout.brickWidth, layout.brickHeight };
+				hits += checkCollision(balls[i], brick);
+			}
+		}
+		double indexNs = secondsSince(start) * 1e9 / queries;
+
+		//The same lookups with neighbours one after the other
+		std::vector<Rect> ordered = balls;
+		std::sort(ordered.begin(), ordered.end(), [](const Rect& a, const Rect& b)
+		{
+			return a.y / 40 != b.y / 40 ? a.y < b.y : a.x < b.x;
+		});
+		start = std::chrono::steady_clock::now();
+		for (int i = 0; i < queries; i++)
+		{
+			layout.index.query(ordered[i], nearby);
+			for (size_t n = 0; n < nearby.size(); n++)
+			{
+				Rect brick = { layout.posX[nearby[n]], layout.posY[nearby[n]], layout.brickWidth, layout.brickHeight };
+				hits += checkCollision(ordered[i], brick);
+			}
+		}
+		double orderedNs = secondsSince(start) * 1e9 / queries;
+
+		//Every brick against every ball, on fewer balls so it finishes
+		int bruteQueries = (int)std::min<long long>(queries, 20000000LL / brickCount);
+		long long bruteHits = 0;
+		long long bruteCheck = 0;
+		start = std::chrono::steady_clock::now();
+		for (int i = 0; i < bruteQueries; i++)
+		{
+			for (int b = 0; b < brickCount; b++)
+			{
+				Rect brick = { layout.posX[b], layout.posY[b], layout.brickWidth, layout.brickHeight };
+				bruteHits += checkCollision(balls[i], brick);
+			}
+		}
+		double bruteNs = secondsSince(start) * 1e9 / bruteQueries;
+
+		//Both ways have to find the same bricks
+		for (int i = 0; i < bruteQueries; i++)
+		{
+			layout.index.query(balls[i], nearby);
+			for (size_t n = 0; n < nearby.size(); n++)
+			{
+				Rect brick = { layout.posX[nearby[n]], layout.posY[nearby[n]], layout.brickWidth, layout.brickHeight };
+				bruteCheck += checkCollision(balls[i], brick);
+			}
+		}
+		if (bruteCheck != bruteHits)
+		{
+			printf("Broadphase missed bricks with %d bricks: %lld vs %lld hits\n", brickCount, bruteCheck, bruteHits);
+			return 1;
+		}
+
+		printf("%10d %14.1f %16.1f %12.2f %14.1f %9.0fx\n", brickCount, indexNs, orderedNs, (double)candidates / queries, bruteNs, bruteNs / indexNs);
+		if (hits < 0)
+			printf("%lld\n", hits);
+	}
+
+	return 0;
+}
@@ -0,0 +1,93 @@
+/*
+PROGRAM: Brick Breakers Using SDL
+PART: Level loading benchmark. Times switching between two mapped binary
+      levels of 24 up to 100,000 bricks, against reading the same level
+      from its text form and building its broadphase.
+
+      g++ -O2 -I.. LevelBench.cpp ../core/[A-Z]*.cpp -o level_bench
+*/
+#include <stdio.h>
+#include <chrono>
+
+#include "core/LevelFile.h"
+
+static double secondsSince(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+//Writes a level of rows of bricks out as text
+static bool writeText(const char* path, int brickCount, int columns)
+{
+	FILE* file = fopen(path, "w");
+	if (file == NULL)
+		return false;
+	fprintf(file, "size 50 25\n");
+	for (int i = 0; i < brickCount; i++)
+		fprintf(file, "brick %d %d %d %d\n", 100 + (i % columns) * 65, 80 + (i / columns) * 40, (i / columns) % 3, 1 + i % 3);
+	fclose(file);
+	return true;
+}
+
+int main()
+{
+	const int brickCounts[] = { 24, 1000, 10000, 100000 };
+	const int switches = 2000;
+	const char* textPath = "level_bench.txt";
+	const char* levelPaths[2] = { "level_bench_a.lvl", "level_bench_b.lvl" };
+
+	printf("%10s %16s %16s %12s\n", "bricks", "mapped us/load", "text us/load", "speedup");
+
+	for (int brickCount : brickCounts)
+	{
+		int columns = brickCount < 1000 ? 8 : 400;
+		if (!writeText(textPath, brickCount, columns))
+		{
+			printf("Unable to write %s!\n", textPath);
+			return 1;
+		}
+
+		//The old way: read every line, then build the broadphase
+		BrickLayout layout;
+		int textLoads = brickCount >= 10000 ? 5 : 50;
+		auto start = std::chrono::steady_clock::now();
+		for (int i = 0; i < textLoads; i++)
+		{
+			if (!loadLevelText(textPath, layout))
+				return 1;
+		}
+		double textTime = secondsSince(start) / textLoads;
+
+		//Two files so every load really switches levels
+		for (int i = 0; i < 2; i++)
+		{
+			if (!saveLevel(levelPaths[i], layout))
+				return 1;
+		}
+
+		LevelFile level;
+		long long sink = 0;
+		start = std::chrono::steady_clock::now();
+		for (int i = 0; i < switches; i++)
+		{
+			if (!level.open(levelPaths[i & 1]))
+				return 1;
+
+			//Touch the last brick so the load can't be skipped
+			const BrickLayout& loaded = level.getLayout();
+			sink += loaded.size() + loaded.posX[loaded.size() - 1];
+		}
+		double mappedTime = secondsSince(start) / switches;
+
+		printf("%10d %16.2f %16.2f %11.0fx\n", brickCount, mappedTime * 1e6, textTime * 1e6, textTime / mappedTime);
+		if (sink == 42)
+			printf("\n");
+
+		level.close();
+		remove(levelPaths[0]);
+		remove(levelPaths[1]);
+	}
+	remove(textPath);
+
+	return 0;
+}
@@ -0,0 +1,61 @@
+/*
+PROGRAM: Brick Breakers Using SDL
+PART: Benchmark for the debris particles. Keeps the pool topped up at a
+      set number of live particles, the way a busy wall keeps breaking,
+      and prints one JSON line per count with the average and worst
+      update time and the nanoseconds per particle. Past the capacity
+      the extra particles are dropped and the cost stays where it was.
+
+      g++ -O2 -I.. ParticleBench.cpp ../core/[A-Z]*.cpp -o particle_bench
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+
+#include "core/Game.h"
+#include "core/ParticlePool.h"
+
+int main(int argc, char* args[])
+{
+	const int steps = argc > 1 ? atoi(args[1]) : 2000;
+	const float dt = 1.0f / DEFAULT_TICK_RATE;
+	const int counts[] = { 1000, 10000, 50000, (int)ParticlePool::DEFAULT_CAPACITY, 200000 };
+
+	for (int target : counts)
+	{
+		ParticlePool pool;
+		Random random(2015);
+		Rect wall = { 0, 40, SCREEN_WIDTH, 200 };
+		double total = 0.0, worst = 0.0;
+		unsigned long long particleSteps = 0;
+
+		for (int step = 0; step < steps; step++)
+		{
+			//Replace whatever died, in brick sized bursts
+			int missing = target - (int)pool.size();
+			while (missing > 0)
+			{
+				int burst = missing < 64 ? missing : 64;
+				Rect brick = { wall.x + (int)(random.next() % (wall.w - 50)), wall.y + (int)(random.next() % (wall.h - 25)), 50, 25 };
+				if (pool.spawnBurst(brick, burst, (unsigned char)(step % 3), random) < burst)
+					break;
+				missing -= burst;
+			}
+
+			size_t live = pool.size();
+			auto start = std::chrono::steady_clock::now();
+			pool.update(dt);
+			double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			total += seconds;
+			if (seconds > worst)
+				worst = seconds;
+			particleSteps += live;
+		}
+
+		printf("{\"bench\": \"particles\", \"target\": %d, \"capacity\": %zu, \"steps\": %d, \"avg_live\": %.0f, \"update_avg_us\": %.2f, "
+			"\"update_max_us\": %.2f, \"ns_per_particle\": %.3f, \"dropped\": %llu}\n",
+			target, pool.capacity(), steps, (double)particleSteps / steps, total * 1e6 / steps, worst * 1e6,
+			particleSteps > 0 ? total * 1e9 / particleSteps : 0.0, (unsigned long long)pool.getDropped());
+	}
+	return 0;
+}
@@ -0,0 +1,97 @@
+/*
+PROGRAM: Brick Breakers Using SDL
+PART: Benchmark for rewind. Plays walls of 24 up to 100,000 bricks with
+      the autopilot for longer than the rewind window, saving every step,
+      then goes back as far as the buffer reaches and checks every step
+      against the hash it had on the way forward. Prints one JSON line per
+      wall with the save and rewind time per step next to the step itself,
+      the bytes per step before and after the deltas, and how many
+      seconds fit in the budget.
+
+      g++ -O2 -I.. RewindBench.cpp ../core/[A-Z]*.cpp -o rewind_bench
+      ./rewind_bench [steps] [budget MB]
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <vector>
+
+#include "core/Autopilot.h"
+#include "core/Game.h"
+#include "core/Rewind.h"
+
+static double msSince(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char* args[])
+{
+	const int steps = argc > 1 ? atoi(args[1]) : 40 * DEFAULT_TICK_RATE;
+	const size_t budget = argc > 2 ? (size_t)atoi(args[2]) * 1024 * 1024 : RewindBuffer::DEFAULT_BUDGET;
+	const struct { int bricks; int balls; } walls[] = { { 24, 1 }, { 1000, 10 }, { 10000, 100 }, { 10000, 1000 }, { 100000, 1000 } };
+
+	for (const auto& wall : walls)
+	{
+		//The classic wall for 24, otherwise wide rows of small bricks that
+		// bounce the balls back for good
+		BrickLayout layout;
+		GameConfig config;
+		if (wall.bricks != 24)
+		{
+			int columns = wall.bricks < 2000 ? 50 : 500;
+			layout.brickWidth = SCREEN_WIDTH / columns;
+			layout.brickHeight = 2;
+			layout.addRows(wall.bricks, columns, 0, 40, layout.brickWidth, 3);
+			layout.finish();
+			config.layout = &layout;
+		}
+		config.ballCount = wall.balls;
+		config.floorBounces = true;
+
+		Game game(config);
+		AutopilotConfig pilot;
+		Autopilot autopilot(pilot);
+		RewindBuffer rewind(config.tickRate, RewindBuffer::DEFAULT_SECONDS, budget);
+
+		//Start playing before saving anything
+		while (game.getState().mode != GAMEMODE::PLAY)
+			game.step(autopilot.next(game.getState()));
+
+		std::vector<uint64_t> hashes(steps);
+		double stepMs = 0.0;
+		for (int step = 0; step < steps; step++)
+		{
+			auto start = std::chrono::steady_clock::now();
+			game.step(autopilot.next(game.getState()));
+			stepMs += msSince(start);
+
+			rewind.record(game);
+			hashes[step] = hashState(game.getState());
+		}
+
+		//Everything the buffer still has, newest first
+		double seconds = rewind.getSeconds();
+		size_t bytesUsed = rewind.getBytesUsed();
+		int back = 0, mismatches = 0;
+		while (rewind.rewind(game))
+		{
+			back++;
+			if (hashState(game.getState()) != hashes[steps - 1 - back])
+				mismatches++;
+		}
+
+		const RewindStats& stats = rewind.getStats();
+		printf("{\"bench\": \"rewind\", \"bricks\": %d, \"balls\": %d, \"steps\": %d, \"step_avg_us\": %.2f, "
+			"\"record_avg_us\": %.2f, \"record_max_us\": %.2f, \"rewind_avg_us\": %.2f, \"rewind_max_us\": %.2f, "
+			"\"raw_bytes_per_step\": %.0f, \"stored_bytes_per_step\": %.0f, \"keyframes\": %llu, \"evicted\": %llu, "
+			"\"budget_bytes\": %zu, \"bytes_used\": %zu, \"seconds_held\": %.2f, \"steps_back\": %d, \"mismatches\": %d}\n",
+			wall.bricks, wall.balls, steps, stepMs * 1000.0 / steps,
+			stats.recordMs * 1000.0 / stats.recorded, stats.maxRecordMs * 1000.0,
+			stats.rewound > 0 ? stats.rewindMs * 1000.0 / stats.rewound : 0.0, stats.maxRewindMs * 1000.0,
+			(double)stats.rawBytes / stats.recorded, (double)stats.storedBytes / stats.recorded,
+			(unsigned long long)stats.keyframes, (unsigned long long)stats.evicted,
+			rewind.getBudget(), bytesUsed, seconds, back, mismatches);
+	}
+	return 0;
+}
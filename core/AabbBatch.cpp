@@ -0,0 +1,166 @@
+#include "AabbBatch.h"
+#include "Game.h"
+
+#include "Simd.h"
+
+#include <string.h>
+
+//Scalar version, the same four tests as checkCollision
+static int overlapScalar(const Rect& box, const int* posX, const int* posY, int width, int height, size_t count, uint64_t* hits)
+{
+	int leftA = box.x;
+	int rightA = box.x + box.w;
+	int topA = box.y;
+	int bottomA = box.y + box.h;
+
+	memset(hits, 0, ((count + 63) / 64) * sizeof(uint64_t));
+
+	int total = 0;
+	for (size_t i = 0; i < count; i++)
+	{
+		bool hit = bottomA > posY[i] && topA < posY[i] + height && rightA > posX[i] && leftA < posX[i] + width;
+		hits[i >> 6] |= (uint64_t)hit << (i & 63);
+		total += hit;
+	}
+	return total;
+}
+
+#ifdef BRICK_HAVE_SSE2
+static int overlapSSE2(const Rect& box, const int* posX, const int* posY, int width, int height, size_t count, uint64_t* hits)
+{
+	const __m128i leftA = _mm_set1_epi32(box.x);
+	const __m128i rightA = _mm_set1_epi32(box.x + box.w);
+	const __m128i topA = _mm_set1_epi32(box.y);
+	const __m128i bottomA = _mm_set1_epi32(box.y + box.h);
+	const __m128i w = _mm_set1_epi32(width);
+	const __m128i h = _mm_set1_epi32(height);
+
+	memset(hits, 0, ((count + 63) / 64) * sizeof(uint64_t));
+
+	int total = 0;
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128i leftB = _mm_loadu_si128((const __m128i*)(posX + i));
+		__m128i topB = _mm_loadu_si128((const __m128i*)(posY + i));
+
+		//All four sides have to overlap
+		__m128i hit = _mm_and_si128(_mm_cmpgt_epi32(bottomA, topB), _mm_cmpgt_epi32(_mm_add_epi32(topB, h), topA));
+		hit = _mm_and_si128(hit, _mm_cmpgt_epi32(rightA, leftB));
+		hit = _mm_and_si128(hit, _mm_cmpgt_epi32(_mm_add_epi32(leftB, w), leftA));
+
+		unsigned int mask = (unsigned int)_mm_movemask_ps(_mm_castsi128_ps(hit));
+		hits[i >> 6] |= (uint64_t)mask << (i & 63);
+		total += (mask & 1) + ((mask >> 1) & 1) + ((mask >> 2) & 1) + (mask >> 3);
+	}
+
+	//Whatever doesn't fill a whole register
+	if (i < count)
+	{
+		uint64_t tail[1];
+		total += overlapScalar(box, posX + i, posY + i, width, height, count - i, tail);
+		hits[i >> 6] |= tail[0] << (i & 63);
+	}
+	return total;
+}
+#endif
+
+#ifdef BRICK_HAVE_AVX2
+__attribute__((target("avx2")))
+static int overlapAVX2(const Rect& box, const int* posX, const int* posY, int width, int height, size_t count, uint64_t* hits)
+{
+	const __m256i leftA = _mm256_set1_epi32(box.x);
+	const __m256i rightA = _mm256_set1_epi32(box.x + box.w);
+	const __m256i topA = _mm256_set1_epi32(box.y);
+	const __m256i bottomA = _mm256_set1_epi32(box.y + box.h);
+	const __m256i w = _mm256_set1_epi32(width);
+	const __m256i h = _mm256_set1_epi32(height);
+
+	memset(hits, 0, ((count + 63) / 64) * sizeof(uint64_t));
+
+	int total = 0;
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8)
+	{
+		__m256i leftB = _mm256_loadu_si256((const __m256i*)(posX + i));
+		__m256i topB = _mm256_loadu_si256((const __m256i*)(posY + i));
+
+		//All four sides have to overlap
+		__m256i hit = _mm256_and_si256(_mm256_cmpgt_epi32(bottomA, topB), _mm256_cmpgt_epi32(_mm256_add_epi32(topB, h), topA));
+		hit = _mm256_and_si256(hit, _mm256_cmpgt_epi32(rightA, leftB));
+		hit = _mm256_and_si256(hit, _mm256_cmpgt_epi32(_mm256_add_epi32(leftB, w), leftA));
+
+		unsigned int mask = (unsigned int)_mm256_movemask_ps(_mm256_castsi256_ps(hit));
+		hits[i >> 6] |= (uint64_t)mask << (i & 63);
+		total += __builtin_popcount(mask);
+	}
+
+	//Whatever doesn't fill a whole register
+	if (i < count)
+	{
+		uint64_t tail[1];
+		total += overlapScalar(box, posX + i, posY + i, width, height, count - i, tail);
+		hits[i >> 6] |= tail[0] << (i & 63);
+	}
+	return total;
+}
+#endif
+
+OverlapBatchFunction overlapBatchScalar()
+{
+	return overlapScalar;
+}
+
+OverlapBatchFunction overlapBatchSSE2()
+{
+#ifdef BRICK_HAVE_SSE2
+	return overlapSSE2;
+#else
+	return NULL;
+#endif
+}
+
+OverlapBatchFunction overlapBatchAVX2()
+{
+#ifdef BRICK_HAVE_AVX2
+	if (__builtin_cpu_supports("avx2"))
+		return overlapAVX2;
+#endif
+	return NULL;
+}
+
+//Picks the best version once, the first time it is needed
+static OverlapBatchFunction pickOverlapBatch(const char** name)
+{
+	static const char* pickedName = "scalar";
+	static const OverlapBatchFunction picked = []()
+	{
+		if (overlapBatchAVX2() != NULL)
+		{
+			pickedName = "avx2";
+			return overlapBatchAVX2();
+		}
+		if (overlapBatchSSE2() != NULL)
+		{
+			pickedName = "sse2";
+			return overlapBatchSSE2();
+		}
+		return overlapBatchScalar();
+	}();
+
+	if (name != NULL)
+		*name = pickedName;
+	return picked;
+}
+
+int overlapBatch(const Rect& box, const int* posX, const int* posY, int width, int height, size_t count, uint64_t* hits)
+{
+	return pickOverlapBatch(NULL)(box, posX, posY, width, height, count, hits);
+}
+
+const char* overlapBatchName()
+{
+	const char* name;
+	pickOverlapBatch(&name);
+	return name;
+}
@@ -0,0 +1,31 @@
+/*
+PROGRAM: Brick Breakers Using SDL
+PART: Tests one box against a packed run of same sized boxes at once,
+      four (SSE2) or eight (AVX2) at a time.
+*/
+#ifndef BRICK_AABBBATCH_H
+#define BRICK_AABBBATCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct Rect;
+
+//Signature shared by every version of the kernel. Box i is
+// { posX[i], posY[i], width, height }, and bit i of hits gets set when
+// checkCollision(box, box i) would be true. hits needs (count + 63) / 64
+// words. Returns how many boxes were hit.
+typedef int (*OverlapBatchFunction)(const Rect& box, const int* posX, const int* posY, int width, int height, size_t count, uint64_t* hits);
+
+//The fastest version this CPU can run
+int overlapBatch(const Rect& box, const int* posX, const int* posY, int width, int height, size_t count, uint64_t* hits);
+
+//Name of the version overlapBatch() picked
+const char* overlapBatchName();
+
+//Each version on its own, a version the build or CPU can't run is NULL
+OverlapBatchFunction overlapBatchScalar();
+OverlapBatchFunction overlapBatchSSE2();
+OverlapBatchFunction overlapBatchAVX2();
+
+#endif
@@ -0,0 +1,183 @@
+#include "AssetPack.h"
+
+#include <stdio.h>
+#include <string.h>
+
+//What byteOrder reads as on a machine with the same byte order as the writer
+static const uint32_t ASSET_PACK_BYTE_ORDER = 0x01020304;
+
+static_assert(sizeof(AssetPackHeader) == 16, "AssetPackHeader must not have padding");
+static_assert(sizeof(AssetPackEntry) == 64, "AssetPackEntry must not have padding");
+
+AssetPack::AssetPack()
+{
+	mEntries = NULL;
+	mEntryCount = 0;
+}
+
+bool AssetPack::open(const char* path)
+{
+	close();
+
+	if (!mFile.open(path))
+		return false;
+
+	const unsigned char* data = mFile.getData();
+	size_t size = mFile.getSize();
+
+	AssetPackHeader header;
+	if (size < sizeof(header))
+	{
+		printf("%s is too short to be an asset pack\n", path);
+		close();
+		return false;
+	}
+	memcpy(&header, data, sizeof(header));
+
+	if (memcmp(header.magic, "BRKA", 4) != 0 || header.byteOrder != ASSET_PACK_BYTE_ORDER || header.version != ASSET_PACK_VERSION)
+	{
+		printf("%s is not an asset pack this build can read\n", path);
+		close();
+		return false;
+	}
+
+	//The table and every blob it points to have to be inside the file
+	bool valid = header.entryCount <= (size - sizeof(header)) / sizeof(AssetPackEntry);
+	const AssetPackEntry* entries = (const AssetPackEntry*)(data + sizeof(header));
+	for (uint32_t i = 0; valid && i < header.entryCount; i++)
+	{
+		valid = entries[i].offset <= size && entries[i].size <= size - entries[i].offset
+			&& memchr(entries[i].name, '\0', sizeof(entries[i].name)) != NULL;
+	}
+	if (!valid)
+	{
+		printf("%s is damaged\n", path);
+		close();
+		return false;
+	}
+
+	mEntries = entries;
+	mEntryCount = header.entryCount;
+	return true;
+}
+
+void AssetPack::close()
+{
+	mEntries = NULL;
+	mEntryCount = 0;
+	mFile.close();
+}
+
+bool AssetPack::isOpen() const
+{
+	return mEntries != NULL;
+}
+
+const unsigned char* AssetPack::find(const char* name, size_t& size) const
+{
+	//A handful of assets, so a walk through the table is plenty
+	for (size_t i = 0; i < mEntryCount; i++)
+	{
+		if (strcmp(mEntries[i].name, name) == 0)
+		{
+			size = (size_t)mEntries[i].size;
+			return mFile.getData() + mEntries[i].offset;
+		}
+	}
+
+	size = 0;
+	return NULL;
+}
+
+size_t AssetPack::getEntryCount() const
+{
+	return mEntryCount;
+}
+
+//Reads a whole file into memory
+static bool readFile(const char* path, std::vector<unsigned char>& bytes)
+{
+	FILE* file = fopen(path, "rb");
+	if (file == NULL)
+	{
+		printf("Unable to open %s!\n", path);
+		return false;
+	}
+
+	bytes.clear();
+	unsigned char buffer[65536];
+	size_t count;
+	while ((count = fread(buffer, 1, sizeof(buffer), file)) > 0)
+		bytes.insert(bytes.end(), buffer, buffer + count);
+
+	bool success = !ferror(file);
+	fclose(file);
+	if (!success)
+		printf("Unable to read %s!\n", path);
+	return success;
+}
+
+bool saveAssetPack(const char* path, const std::vector<std::string>& files)
+{
+	AssetPackHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, "BRKA", 4);
+	header.byteOrder = ASSET_PACK_BYTE_ORDER;
+	header.version = ASSET_PACK_VERSION;
+	header.entryCount = (uint32_t)files.size();
+
+	//Lay out the table first, the blobs follow it
+	std::vector<AssetPackEntry> entries(files.size());
+	std::vector<std::vector<unsigned char> > blobs(files.size());
+	uint64_t offset = sizeof(header) + files.size() * sizeof(AssetPackEntry);
+	for (size_t i = 0; i < files.size(); i++)
+	{
+		if (!readFile(files[i].c_str(), blobs[i]))
+			return false;
+
+		//Stored under the name without its directories
+		size_t slash = files[i].find_last_of("/\\");
+		std::string name = slash == std::string::npos ? files[i] : files[i].substr(slash + 1);
+		if (name.size() >= sizeof(entries[i].name))
+		{
+			printf("Unable to pack %s, the name is longer than %zu characters\n", files[i].c_str(), sizeof(entries[i].name) - 1);
+			return false;
+		}
+
+		memset(&entries[i], 0, sizeof(entries[i]));
+		memcpy(entries[i].name, name.c_str(), name.size());
+		offset = (offset + ASSET_PACK_ALIGNMENT - 1) / ASSET_PACK_ALIGNMENT * ASSET_PACK_ALIGNMENT;
+		entries[i].offset = offset;
+		entries[i].size = blobs[i].size();
+		offset += blobs[i].size();
+	}
+
+	FILE* file = fopen(path, "wb");
+	if (file == NULL)
+	{
+		printf("Unable to create %s!\n", path);
+		return false;
+	}
+
+	fwrite(&header, sizeof(header), 1, file);
+	if (!entries.empty())
+		fwrite(&entries[0], sizeof(AssetPackEntry), entries.size(), file);
+
+	static const char zeros[ASSET_PACK_ALIGNMENT] = { 0 };
+	for (size_t i = 0; i < files.size(); i++)
+	{
+		long at = ftell(file);
+		if (at >= 0 && (uint64_t)at < entries[i].offset)
+			fwrite(zeros, 1, (size_t)(entries[i].offset - (uint64_t)at), file);
+		if (!blobs[i].empty())
+			fwrite(&blobs[i][0], 1, blobs[i].size(), file);
+	}
+
+	bool success = !ferror(file);
+	if (fclose(file) != 0 || !success)
+	{
+		printf("Unable to write %s!\n", path);
+		return false;
+	}
+	return true;
+}
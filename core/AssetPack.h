@@ -0,0 +1,76 @@
+/*
+PROGRAM: Brick Breakers Using SDL
+PART: The asset pack. Every file the game loads, kept in one mapped file
+      behind a table of contents, so an asset is a pointer and a size
+      instead of a trip to the disk.
+*/
+#ifndef BRICK_ASSETPACK_H
+#define BRICK_ASSETPACK_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "MappedFile.h"
+
+//Version of the pack layout this build reads and writes
+const uint32_t ASSET_PACK_VERSION = 1;
+
+//Every blob starts on a boundary this size
+const uint32_t ASSET_PACK_ALIGNMENT = 64;
+
+//Start of a pack, followed by entryCount entries and then the blobs
+struct AssetPackHeader
+{
+	//Always "BRKA"
+	char magic[4];
+
+	//0x01020304 as written by the machine that made the file
+	uint32_t byteOrder;
+
+	uint32_t version;
+	uint32_t entryCount;
+};
+
+//One asset in the table of contents
+struct AssetPackEntry
+{
+	//The file name the asset was packed from, zero padded
+	char name[48];
+
+	//Where the blob starts, in bytes from the start of the pack, and its size
+	uint64_t offset;
+	uint64_t size;
+};
+
+class AssetPack
+{
+public:
+	AssetPack();
+
+	//Maps a pack and checks its table of contents
+	bool open(const char* path);
+
+	//Unmaps the pack, every asset pointer handed out goes with it
+	void close();
+
+	//If a pack is mapped
+	bool isOpen() const;
+
+	//The bytes of an asset and their count, NULL if the pack doesn't have it
+	const unsigned char* find(const char* name, size_t& size) const;
+
+	size_t getEntryCount() const;
+
+private:
+	MappedFile mFile;
+
+	const AssetPackEntry* mEntries;
+	size_t mEntryCount;
+};
+
+//Packs files together, each stored under its name without the directories
+bool saveAssetPack(const char* path, const std::vector<std::string>& files);
+
+#endif
@@ -0,0 +1,95 @@
+#include "Autopilot.h"
+
+#include <math.h>
+
+Autopilot::Autopilot(const AutopilotConfig& config)
+	: mRandom(config.seed)
+{
+	mGiveUpAfter = config.giveUpAfter;
+	mPlayer = config.player;
+	mPlaySteps = 0;
+	mAim = 0.0f;
+	mTarget = -1;
+	mSpaceHeld = false;
+}
+
+Input Autopilot::next(const GameState& state)
+{
+	Input input;
+	if (state.mode != GAMEMODE::PLAY)
+	{
+		//Tap Space to move on to the next screen
+		mSpaceHeld = !mSpaceHeld;
+		if (mSpaceHeld)
+			input.keys = KEY_SPACE;
+		mPlaySteps = 0;
+		mTarget = -1;
+		return input;
+	}
+	mSpaceHeld = false;
+
+	mPlaySteps++;
+	bool givenUp = mGiveUpAfter > 0 && mPlaySteps > mGiveUpAfter;
+
+	//Follow the falling ball that is closest to the paddle, or the lowest
+	// one if they are all on their way up
+	const BallSet& balls = state.balls;
+	int target = -1;
+	bool falling = false;
+	for (size_t i = 0; i < balls.size(); i++)
+	{
+		bool ballFalling = balls.yVel[i] > 0.0f;
+		if (target < 0 || (ballFalling && !falling) || (ballFalling == falling && balls.y[i] > balls.y[target]))
+		{
+			target = (int)i;
+			falling = ballFalling;
+		}
+	}
+	if (target < 0)
+		return input;
+
+	//Out of time, get out from under the ball so it falls
+	if (givenUp)
+	{
+		float landing = landingX(state, paddleOf(state), target) + Ball::BALL_SIZE / 2.0f;
+		input.keys = landing < SCREEN_WIDTH / 2.0f ? KEY_RIGHT : KEY_LEFT;
+		return input;
+	}
+
+	//A new ball gets caught somewhere else on the paddle, the ends send it
+	// back the way it came so the walls get cleared from every side
+	if (falling && target != mTarget)
+		mAim = mRandom.range(-Paddle::PLAYER_WIDTH * 0.45f, Paddle::PLAYER_WIDTH * 0.45f);
+	mTarget = falling ? target : -1;
+
+	//Balls on their way up are only shadowed from under the middle
+	const Paddle& paddle = paddleOf(state);
+	float ballCenter = (falling ? landingX(state, paddle, target) : balls.x[target]) + Ball::BALL_SIZE / 2.0f;
+	float paddleCenter = paddle.mPosX + Paddle::PLAYER_WIDTH / 2.0f + (falling ? mAim : 0.0f);
+	if (ballCenter < paddleCenter - DEAD_ZONE)
+		input.keys |= KEY_LEFT;
+	else if (ballCenter > paddleCenter + DEAD_ZONE)
+		input.keys |= KEY_RIGHT;
+	return input;
+}
+
+const Paddle& Autopilot::paddleOf(const GameState& state) const
+{
+	return mPlayer == 1 && state.players > 1 ? state.paddle2 : state.paddle;
+}
+
+float Autopilot::landingX(const GameState& state, const Paddle& paddle, int ball)
+{
+	const BallSet& balls = state.balls;
+	float drop = paddle.mPosY - Ball::BALL_SIZE - balls.y[ball];
+	if (drop <= 0.0f || balls.yVel[ball] <= 0.0f)
+		return balls.x[ball];
+
+	//Unfold the bounces off the side walls
+	float span = (float)(SCREEN_WIDTH - Ball::BALL_SIZE);
+	float x = balls.x[ball] + balls.xVel[ball] * (drop / balls.yVel[ball]);
+	x = fmodf(x, 2.0f * span);
+	if (x < 0.0f)
+		x += 2.0f * span;
+	return x > span ? 2.0f * span - x : x;
+}
@@ -0,0 +1,64 @@
+/*
+PROGRAM: Brick Breakers Using SDL
+PART: A paddle that plays itself. Reads where the balls are heading and
+      picks the keys a player would hold, and presses Space to get past
+      the menu and the end screens, so games can be played unattended.
+*/
+#ifndef BRICK_AUTOPILOT_H
+#define BRICK_AUTOPILOT_H
+
+#include "Game.h"
+#include "Random.h"
+
+//How the autopilot plays
+struct AutopilotConfig
+{
+	//Decides where on the paddle each ball gets caught
+	unsigned int seed = 1;
+
+	//Steps of play after which the autopilot moves out of the way and lets the
+	// balls fall, so every game ends even if the last bricks are never hit.
+	// 0 plays on until the bricks run out.
+	unsigned int giveUpAfter = 0;
+
+	//Which paddle it plays in a versus game, 0 for the first player's
+	int player = 0;
+};
+
+class Autopilot
+{
+public:
+	//Pixels the paddle may be off its mark before it moves
+	static constexpr float DEAD_ZONE = 4.0f;
+
+	explicit Autopilot(const AutopilotConfig& config = AutopilotConfig());
+
+	//The keys to hold for the next step of a game in the given state. The
+	// same states in the same order always get the same keys.
+	Input next(const GameState& state);
+
+private:
+	//Where the ball will be along the paddle when it gets down to it,
+	// following it off the side walls
+	static float landingX(const GameState& state, const Paddle& paddle, int ball);
+
+	//The paddle being played
+	const Paddle& paddleOf(const GameState& state) const;
+
+	Random mRandom;
+	unsigned int mGiveUpAfter;
+	int mPlayer;
+
+	//Steps of play in the current game
+	unsigned int mPlaySteps;
+
+	//How far from the middle of the paddle the ball being followed gets
+	// caught, picked again every time a new ball is followed
+	float mAim;
+	int mTarget;
+
+	//If Space was held last step, it has to be let go of between presses
+	bool mSpaceHeld;
+};
+
+#endif
@@ -0,0 +1,192 @@
+#include "BallSet.h"
+#include "Game.h"
+#include "Simd.h"
+
+#include <math.h>
+#include <string.h>
+
+void BallSet::clear()
+{
+	x.clear();
+	y.clear();
+	prevX.clear();
+	prevY.clear();
+	xVel.clear();
+	yVel.clear();
+	owner.clear();
+}
+
+int BallSet::add(float posX, float posY, float velX, float velY, unsigned char ballOwner)
+{
+	x.push_back(posX);
+	y.push_back(posY);
+	prevX.push_back(posX);
+	prevY.push_back(posY);
+	xVel.push_back(velX);
+	yVel.push_back(velY);
+	owner.push_back(ballOwner);
+	return (int)x.size() - 1;
+}
+
+size_t BallSet::size() const
+{
+	return x.size();
+}
+
+Rect BallSet::getRect(int ball) const
+{
+	Rect rect = { (int)x[ball], (int)y[ball], Ball::BALL_SIZE, Ball::BALL_SIZE };
+	return rect;
+}
+
+void BallSet::savePositions()
+{
+	if (x.empty())
+		return;
+	memcpy(&prevX[0], &x[0], x.size() * sizeof(float));
+	memcpy(&prevY[0], &y[0], y.size() * sizeof(float));
+}
+
+void BallSet::removeLost(const std::vector<unsigned char>& flags)
+{
+	size_t kept = 0;
+	for (size_t i = 0; i < x.size(); i++)
+	{
+		if (flags[i] & BALL_LOST)
+			continue;
+		x[kept] = x[i];
+		y[kept] = y[i];
+		prevX[kept] = prevX[i];
+		prevY[kept] = prevY[i];
+		xVel[kept] = xVel[i];
+		yVel[kept] = yVel[i];
+		owner[kept] = owner[i];
+		kept++;
+	}
+
+	x.resize(kept);
+	y.resize(kept);
+	prevX.resize(kept);
+	prevY.resize(kept);
+	xVel.resize(kept);
+	yVel.resize(kept);
+	owner.resize(kept);
+}
+
+//One ball of the fast pass, also covers what doesn't fill a register
+static void integrateBall(BallSet& balls, size_t i, float dt, float maxX, float size, const Rect& zone, float lowZoneTop, unsigned char* flags)
+{
+	float x = balls.x[i], y = balls.y[i];
+	float vx = balls.xVel[i], vy = balls.yVel[i];
+
+	//Where it would end up, mirrored back in off the walls and ceiling
+	float nx = x + vx * dt;
+	float ny = y + vy * dt;
+	float rx = nx, rvx = vx;
+	if (nx < 0.0f)
+	{
+		rx = -nx;
+		rvx = fabsf(vx);
+	}
+	else if (nx > maxX)
+	{
+		rx = 2.0f * maxX - nx;
+		rvx = -fabsf(vx);
+	}
+	float ry = ny, rvy = vy;
+	if (ny < 0.0f)
+	{
+		ry = -ny;
+		rvy = fabsf(vy);
+	}
+
+	//Everything the ball passes over on the way
+	float left = fminf(fminf(x, rx), fmaxf(nx, 0.0f));
+	float right = fmaxf(fmaxf(x, rx), fminf(nx, maxX)) + size;
+	float top = fminf(fminf(y, ry), fmaxf(ny, 0.0f));
+	float bottom = fmaxf(fmaxf(y, ry), ny) + size;
+
+	bool near = (right > zone.x && left < zone.x + zone.w && bottom > zone.y && top < zone.y + zone.h) || bottom > lowZoneTop;
+	if (near)
+	{
+		flags[i] = BALL_NEAR;
+		return;
+	}
+
+	balls.x[i] = rx;
+	balls.y[i] = ry;
+	balls.xVel[i] = rvx;
+	balls.yVel[i] = rvy;
+	flags[i] = (rx != nx || ry != ny) ? BALL_BOUNCED : 0;
+}
+
+void integrateBalls(BallSet& balls, float dt, const Rect& brickZone, float lowZoneTop, unsigned char* flags)
+{
+	const float size = (float)Ball::BALL_SIZE;
+	const float maxX = (float)(SCREEN_WIDTH - Ball::BALL_SIZE);
+	size_t count = balls.size();
+	size_t i = 0;
+
+#ifdef BRICK_HAVE_SSE2
+	const __m128 vdt = _mm_set1_ps(dt);
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 vmaxX = _mm_set1_ps(maxX);
+	const __m128 twoMaxX = _mm_set1_ps(2.0f * maxX);
+	const __m128 vsize = _mm_set1_ps(size);
+	const __m128 signBit = _mm_set1_ps(-0.0f);
+	const __m128 zoneLeft = _mm_set1_ps((float)brickZone.x);
+	const __m128 zoneRight = _mm_set1_ps((float)(brickZone.x + brickZone.w));
+	const __m128 zoneTop = _mm_set1_ps((float)brickZone.y);
+	const __m128 zoneBottom = _mm_set1_ps((float)(brickZone.y + brickZone.h));
+	const __m128 vlowZoneTop = _mm_set1_ps(lowZoneTop);
+
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128 x = _mm_loadu_ps(&balls.x[i]);
+		__m128 y = _mm_loadu_ps(&balls.y[i]);
+		__m128 vx = _mm_loadu_ps(&balls.xVel[i]);
+		__m128 vy = _mm_loadu_ps(&balls.yVel[i]);
+
+		__m128 nx = _mm_add_ps(x, _mm_mul_ps(vx, vdt));
+		__m128 ny = _mm_add_ps(y, _mm_mul_ps(vy, vdt));
+
+		//Mirror back in off the walls and the ceiling
+		__m128 hitLeft = _mm_cmplt_ps(nx, zero);
+		__m128 hitRight = _mm_cmpgt_ps(nx, vmaxX);
+		__m128 hitTop = _mm_cmplt_ps(ny, zero);
+		__m128 absVx = _mm_andnot_ps(signBit, vx);
+		__m128 absVy = _mm_andnot_ps(signBit, vy);
+
+		__m128 rx = _mm_or_ps(_mm_and_ps(hitLeft, _mm_sub_ps(zero, nx)), _mm_andnot_ps(hitLeft, nx));
+		rx = _mm_or_ps(_mm_and_ps(hitRight, _mm_sub_ps(twoMaxX, nx)), _mm_andnot_ps(hitRight, rx));
+		__m128 rvx = _mm_or_ps(_mm_and_ps(hitLeft, absVx), _mm_andnot_ps(hitLeft, vx));
+		rvx = _mm_or_ps(_mm_and_ps(hitRight, _mm_or_ps(absVx, signBit)), _mm_andnot_ps(hitRight, rvx));
+		__m128 ry = _mm_or_ps(_mm_and_ps(hitTop, _mm_sub_ps(zero, ny)), _mm_andnot_ps(hitTop, ny));
+		__m128 rvy = _mm_or_ps(_mm_and_ps(hitTop, absVy), _mm_andnot_ps(hitTop, vy));
+
+		//Everything the ball passes over on the way
+		__m128 left = _mm_min_ps(_mm_min_ps(x, rx), _mm_max_ps(nx, zero));
+		__m128 right = _mm_add_ps(_mm_max_ps(_mm_max_ps(x, rx), _mm_min_ps(nx, vmaxX)), vsize);
+		__m128 top = _mm_min_ps(_mm_min_ps(y, ry), _mm_max_ps(ny, zero));
+		__m128 bottom = _mm_add_ps(_mm_max_ps(_mm_max_ps(y, ry), ny), vsize);
+
+		__m128 inZone = _mm_and_ps(_mm_and_ps(_mm_cmpgt_ps(right, zoneLeft), _mm_cmplt_ps(left, zoneRight)),
+			_mm_and_ps(_mm_cmpgt_ps(bottom, zoneTop), _mm_cmplt_ps(top, zoneBottom)));
+		__m128 near = _mm_or_ps(inZone, _mm_cmpgt_ps(bottom, vlowZoneTop));
+
+		//Near balls keep their old state for the exact pass
+		_mm_storeu_ps(&balls.x[i], _mm_or_ps(_mm_and_ps(near, x), _mm_andnot_ps(near, rx)));
+		_mm_storeu_ps(&balls.y[i], _mm_or_ps(_mm_and_ps(near, y), _mm_andnot_ps(near, ry)));
+		_mm_storeu_ps(&balls.xVel[i], _mm_or_ps(_mm_and_ps(near, vx), _mm_andnot_ps(near, rvx)));
+		_mm_storeu_ps(&balls.yVel[i], _mm_or_ps(_mm_and_ps(near, vy), _mm_andnot_ps(near, rvy)));
+
+		int nearMask = _mm_movemask_ps(near);
+		int bounceMask = _mm_movemask_ps(_mm_or_ps(_mm_or_ps(hitLeft, hitRight), hitTop)) & ~nearMask;
+		for (int lane = 0; lane < 4; lane++)
+			flags[i + lane] = (unsigned char)((((nearMask >> lane) & 1) ? BALL_NEAR : 0) | (((bounceMask >> lane) & 1) ? BALL_BOUNCED : 0));
+	}
+#endif
+
+	for (; i < count; i++)
+		integrateBall(balls, i, dt, maxX, size, brickZone, lowZoneTop, flags);
+}
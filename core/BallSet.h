@@ -0,0 +1,60 @@
+/*
+PROGRAM: Brick Breakers Using SDL
+PART: Every ball in play, one array per field, and the vectorized pass
+      that moves the balls that are nowhere near a brick or the paddle.
+*/
+#ifndef BRICK_BALLSET_H
+#define BRICK_BALLSET_H
+
+#include <stddef.h>
+#include <vector>
+
+struct Rect;
+
+//What the fast pass found out about each ball
+enum BallFlag
+{
+	//Bounced off a wall or the ceiling
+	BALL_BOUNCED = 1 << 0,
+
+	//Might touch a brick, the paddle or the floor, left for the exact pass
+	BALL_NEAR = 1 << 1,
+
+	//Fell out the bottom
+	BALL_LOST = 1 << 2
+};
+
+class BallSet
+{
+public:
+	//Removes every ball
+	void clear();
+
+	//Adds a ball, returns its index
+	int add(float posX, float posY, float velX, float velY, unsigned char ballOwner = 0);
+
+	size_t size() const;
+
+	Rect getRect(int ball) const;
+
+	//Remembers where every ball is before it moves, for drawing between steps
+	void savePositions();
+
+	//Drops every ball with BALL_LOST set in flags, keeping the rest in order
+	void removeLost(const std::vector<unsigned char>& flags);
+
+	std::vector<float> x, y;
+	std::vector<float> prevX, prevY;
+	std::vector<float> xVel, yVel;
+
+	//The player whose paddle last hit each ball
+	std::vector<unsigned char> owner;
+};
+
+//Moves every ball dt seconds and bounces it off the side walls and the
+// ceiling, four at a time. Balls whose move comes near brickZone or below
+// lowZoneTop are left where they were and marked BALL_NEAR, the exact
+// swept pass has to move those. flags needs one entry per ball.
+void integrateBalls(BallSet& balls, float dt, const Rect& brickZone, float lowZoneTop, unsigned char* flags);
+
+#endif
@@ -0,0 +1,221 @@
+#include "BrickGrid.h"
+#include "Game.h"
+#include "Hash.h"
+
+#include <string.h>
+
+BrickLayout::BrickLayout()
+{
+	brickWidth = DEFAULT_BRICK_WIDTH;
+	brickHeight = DEFAULT_BRICK_HEIGHT;
+	mCount = 0;
+	pointAtStorage();
+}
+
+void BrickLayout::clear()
+{
+	mCount = 0;
+	mPosX.clear();
+	mPosY.clear();
+	mType.clear();
+	mHealth.clear();
+	pointAtStorage();
+	index.clear();
+}
+
+void BrickLayout::addBrick(int x, int y, unsigned char brickType, unsigned char brickHealth)
+{
+	own();
+	mPosX.push_back(x);
+	mPosY.push_back(y);
+	mType.push_back(brickType);
+	mHealth.push_back(brickHealth > 0 ? brickHealth : 1);
+	mCount++;
+	pointAtStorage();
+}
+
+void BrickLayout::addRows(int count, int columns, int startX, int startY, int stepX, int stepY)
+{
+	own();
+	mPosX.reserve(mCount + count);
+	mPosY.reserve(mCount + count);
+	mType.reserve(mCount + count);
+	mHealth.reserve(mCount + count);
+
+	for (int i = 0; i < count; i++)
+	{
+		int row = i / columns;
+		addBrick(startX + (i % columns) * stepX, startY + row * stepY, (unsigned char)(row % 3));
+	}
+}
+
+void BrickLayout::finish()
+{
+	index.build(posX, posY, mCount, brickWidth, brickHeight);
+}
+
+void BrickLayout::attach(size_t count, int width, int height, const int* x, const int* y,
+	const unsigned char* types, const unsigned char* healths, const BrickIndexCells& cells)
+{
+	clear();
+	mCount = count;
+	brickWidth = width;
+	brickHeight = height;
+	posX = x;
+	posY = y;
+	type = types;
+	health = healths;
+	index.attach(cells);
+}
+
+bool BrickLayout::isFinished() const
+{
+	return index.size() == size();
+}
+
+size_t BrickLayout::size() const
+{
+	return mCount;
+}
+
+void BrickLayout::own()
+{
+	if (posX == mPosX.data() || mCount == 0)
+		return;
+
+	mPosX.assign(posX, posX + mCount);
+	mPosY.assign(posY, posY + mCount);
+	mType.assign(type, type + mCount);
+	mHealth.assign(health, health + mCount);
+	pointAtStorage();
+
+	//The attached broadphase doesn't know about the new bricks
+	index.clear();
+}
+
+void BrickLayout::pointAtStorage()
+{
+	posX = mPosX.data();
+	posY = mPosY.data();
+	type = mType.data();
+	health = mHealth.data();
+}
+
+const BrickLayout& classicLayout()
+{
+	struct Classic : BrickLayout
+	{
+		Classic()
+		{
+			//Three rows of eight
+			addRows(24, 8, 100, 80, 65, 40);
+			finish();
+		}
+	};
+	static const Classic layout;
+	return layout;
+}
+
+uint64_t hashLayout(const BrickLayout& layout)
+{
+	size_t count = layout.size();
+	uint64_t hash = hashValue((uint64_t)count, HASH_START);
+	hash = hashValue(layout.brickWidth, hash);
+	hash = hashValue(layout.brickHeight, hash);
+	if (count > 0)
+	{
+		hash = hashBytes(layout.posX, count * sizeof(int), hash);
+		hash = hashBytes(layout.posY, count * sizeof(int), hash);
+		hash = hashBytes(layout.type, count, hash);
+		hash = hashBytes(layout.health, count, hash);
+	}
+	return hash;
+}
+
+BrickGrid::BrickGrid()
+{
+	mLayout = NULL;
+	mAliveCount = 0;
+}
+
+void BrickGrid::reset(const BrickLayout* layout)
+{
+	mLayout = layout;
+	size_t count = layout != NULL ? layout->size() : 0;
+
+	if (count > 0)
+		mHealth.assign(layout->health, layout->health + count);
+	else
+		mHealth.clear();
+
+	//Every brick starts standing, the bits past the last brick stay clear
+	mAlive.assign((count + 63) / 64, ~(uint64_t)0);
+	if (count % 64 != 0)
+		mAlive.back() = ((uint64_t)1 << (count % 64)) - 1;
+	mAliveCount = (int)count;
+}
+
+const BrickLayout* BrickGrid::getLayout() const
+{
+	return mLayout;
+}
+
+size_t BrickGrid::size() const
+{
+	return mHealth.size();
+}
+
+int BrickGrid::getAliveCount() const
+{
+	return mAliveCount;
+}
+
+bool BrickGrid::isAlive(int brick) const
+{
+	return (mAlive[brick >> 6] >> (brick & 63)) & 1;
+}
+
+int BrickGrid::getHealth(int brick) const
+{
+	return mHealth[brick];
+}
+
+bool BrickGrid::damage(int brick)
+{
+	if (!isAlive(brick))
+		return false;
+
+	if (mHealth[brick] > 0)
+		mHealth[brick]--;
+	if (mHealth[brick] > 0)
+		return false;
+
+	mAlive[brick >> 6] &= ~((uint64_t)1 << (brick & 63));
+	mAliveCount--;
+	return true;
+}
+
+Rect BrickGrid::getRect(int brick) const
+{
+	Rect rect = { mLayout->posX[brick], mLayout->posY[brick], mLayout->brickWidth, mLayout->brickHeight };
+	return rect;
+}
+
+const std::vector<uint64_t>& BrickGrid::getAliveBits() const
+{
+	return mAlive;
+}
+
+const std::vector<unsigned char>& BrickGrid::getHealths() const
+{
+	return mHealth;
+}
+
+void BrickGrid::restore(const unsigned char* health, const void* aliveBits, int aliveCount)
+{
+	if (!mHealth.empty())
+		memcpy(&mHealth[0], health, mHealth.size());
+	if (!mAlive.empty())
+		memcpy(&mAlive[0], aliveBits, mAlive.size() * sizeof(uint64_t));
+	mAliveCount = aliveCount;
+}
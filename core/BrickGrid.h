@@ -0,0 +1,151 @@
+/*
+PROGRAM: Brick Breakers Using SDL
+PART: The bricks, kept as parallel arrays so one loop can walk all of
+      them no matter how many there are.
+*/
+#ifndef BRICK_BRICKGRID_H
+#define BRICK_BRICKGRID_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include "BrickIndex.h"
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+struct Rect;
+
+//Index of the lowest set bit, bits must not be zero
+inline int lowestBit(uint64_t bits)
+{
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward64(&index, bits);
+	return (int)index;
+#else
+	return __builtin_ctzll(bits);
+#endif
+}
+
+//Where every brick sits and what it starts out as. This never changes
+// during a game, so many games can share one layout.
+struct BrickLayout
+{
+	//Dimensions of a brick, every brick in a layout is the same size
+	static const int DEFAULT_BRICK_WIDTH = 50;
+	static const int DEFAULT_BRICK_HEIGHT = 25;
+
+	BrickLayout();
+
+	//Removes every brick
+	void clear();
+
+	//Adds a brick with its top left corner at the given point
+	void addBrick(int posX, int posY, unsigned char brickType = 0, unsigned char health = 1);
+
+	//Fills rows of bricks across a field, left to right and top to bottom
+	void addRows(int count, int columns, int startX, int startY, int stepX, int stepY);
+
+	//Builds the broadphase, call it once every brick is in
+	void finish();
+
+	//Uses bricks and a finished broadphase that are kept somewhere else,
+	// such as a mapped level file, without copying them. The arrays have
+	// to outlive the layout, or the next clear().
+	void attach(size_t count, int width, int height, const int* x, const int* y,
+		const unsigned char* types, const unsigned char* healths, const BrickIndexCells& cells);
+
+	//If finish() has been called since the last brick went in
+	bool isFinished() const;
+
+	size_t size() const;
+
+	int brickWidth;
+	int brickHeight;
+
+	//One entry per brick, in the layout's own storage or in whatever it
+	// was attached to
+	const int* posX;
+	const int* posY;
+	const unsigned char* type;
+	const unsigned char* health;
+
+	//Which bricks are near any given spot
+	BrickIndex index;
+
+	//Copying would leave the copy pointing into this layout's arrays
+	BrickLayout(const BrickLayout&) = delete;
+	BrickLayout& operator=(const BrickLayout&) = delete;
+
+private:
+	//Copies attached bricks into the layout's own storage so more can go in
+	void own();
+
+	//Points the columns at the layout's own storage
+	void pointAtStorage();
+
+	size_t mCount;
+
+	//The bricks added one by one, empty while attached
+	std::vector<int> mPosX;
+	std::vector<int> mPosY;
+	std::vector<unsigned char> mType;
+	std::vector<unsigned char> mHealth;
+};
+
+//The three rows of eight the game has always had
+const BrickLayout& classicLayout();
+
+//A fingerprint of where the bricks are and what they start out as
+uint64_t hashLayout(const BrickLayout& layout);
+
+//The bricks of one game: how much health each has left and which are
+// still standing. Positions come from the shared layout.
+class BrickGrid
+{
+public:
+	BrickGrid();
+
+	//Brings every brick of the layout back at full health
+	void reset(const BrickLayout* layout);
+
+	const BrickLayout* getLayout() const;
+
+	size_t size() const;
+
+	//Bricks still standing
+	int getAliveCount() const;
+
+	bool isAlive(int brick) const;
+
+	//Health left on a brick
+	int getHealth(int brick) const;
+
+	//Takes one hit point off a brick, returns true if that destroyed it
+	bool damage(int brick);
+
+	//Where the brick is, worked out from the layout
+	Rect getRect(int brick) const;
+
+	//One bit per brick, set while the brick is standing
+	const std::vector<uint64_t>& getAliveBits() const;
+
+	//Health left on every brick, one byte each
+	const std::vector<unsigned char>& getHealths() const;
+
+	//Puts back the health and standing bits taken from a grid of the same
+	// layout, along with how many bricks were standing
+	void restore(const unsigned char* health, const void* aliveBits, int aliveCount);
+
+private:
+	const BrickLayout* mLayout;
+
+	std::vector<unsigned char> mHealth;
+	std::vector<uint64_t> mAlive;
+	int mAliveCount;
+};
+
+#endif
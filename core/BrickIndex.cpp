@@ -0,0 +1,158 @@
+#include "BrickIndex.h"
+#include "Game.h"
+
+#include <algorithm>
+
+BrickIndex::BrickIndex()
+{
+	clear();
+}
+
+void BrickIndex::clear()
+{
+	mCells.originX = 0;
+	mCells.originY = 0;
+	mCells.cellWidth = 1;
+	mCells.cellHeight = 1;
+	mCells.columns = 0;
+	mCells.rows = 0;
+	mCells.brickCount = 0;
+	mCells.cellStart = NULL;
+	mCells.cellBricks = NULL;
+	mCells.cellBrickCount = 0;
+	mCellStart.clear();
+	mCellBricks.clear();
+}
+
+void BrickIndex::build(const int* posX, const int* posY, size_t count, int brickWidth, int brickHeight)
+{
+	clear();
+
+	if (count == 0 || brickWidth <= 0 || brickHeight <= 0)
+		return;
+
+	//The grid just covers the bricks, one brick sized cell at a time
+	int minX = posX[0], maxX = posX[0];
+	int minY = posY[0], maxY = posY[0];
+	for (size_t i = 1; i < count; i++)
+	{
+		minX = std::min(minX, posX[i]);
+		maxX = std::max(maxX, posX[i]);
+		minY = std::min(minY, posY[i]);
+		maxY = std::max(maxY, posY[i]);
+	}
+
+	int originX = minX;
+	int originY = minY;
+	int columns = (maxX + brickWidth - 1 - minX) / brickWidth + 1;
+	int rows = (maxY + brickHeight - 1 - minY) / brickHeight + 1;
+
+	//Count the bricks in each cell, then turn the counts into offsets
+	mCellStart.assign((size_t)columns * rows + 1, 0);
+	for (int pass = 0; pass < 2; pass++)
+	{
+		std::vector<int> fill;
+		if (pass == 1)
+		{
+			for (size_t c = 1; c < mCellStart.size(); c++)
+				mCellStart[c] += mCellStart[c - 1];
+			mCellBricks.resize(mCellStart.back());
+			fill.assign(mCellStart.begin(), mCellStart.end() - 1);
+		}
+
+		for (size_t i = 0; i < count; i++)
+		{
+			int column0 = (posX[i] - originX) / brickWidth;
+			int column1 = (posX[i] + brickWidth - 1 - originX) / brickWidth;
+			int row0 = (posY[i] - originY) / brickHeight;
+			int row1 = (posY[i] + brickHeight - 1 - originY) / brickHeight;
+
+			for (int row = row0; row <= row1; row++)
+				for (int column = column0; column <= column1; column++)
+				{
+					size_t cell = (size_t)row * columns + column;
+					if (pass == 0)
+						mCellStart[cell + 1]++;
+					else
+						mCellBricks[fill[cell]++] = (int)i;
+				}
+		}
+	}
+
+	mCells.originX = originX;
+	mCells.originY = originY;
+	mCells.cellWidth = brickWidth;
+	mCells.cellHeight = brickHeight;
+	mCells.columns = columns;
+	mCells.rows = rows;
+	mCells.brickCount = count;
+	mCells.cellStart = mCellStart.data();
+	mCells.cellBricks = mCellBricks.data();
+	mCells.cellBrickCount = mCellBricks.size();
+}
+
+void BrickIndex::attach(const BrickIndexCells& cells)
+{
+	clear();
+	mCells = cells;
+}
+
+const BrickIndexCells& BrickIndex::getCells() const
+{
+	return mCells;
+}
+
+size_t BrickIndex::size() const
+{
+	return mCells.brickCount;
+}
+
+Rect BrickIndex::getBounds() const
+{
+	Rect bounds = { mCells.originX, mCells.originY, mCells.columns * mCells.cellWidth, mCells.rows * mCells.cellHeight };
+	return bounds;
+}
+
+void BrickIndex::query(const Rect& area, std::vector<int>& bricks) const
+{
+	bricks.clear();
+	const BrickIndexCells& cells = mCells;
+	if (cells.brickCount == 0 || area.w <= 0 || area.h <= 0)
+		return;
+
+	//Cells the area covers, clamped to the grid
+	int column0 = area.x - cells.originX;
+	int row0 = area.y - cells.originY;
+	int column1 = area.x + area.w - 1 - cells.originX;
+	int row1 = area.y + area.h - 1 - cells.originY;
+	if (column1 < 0 || row1 < 0)
+		return;
+
+	column0 = column0 < 0 ? 0 : column0 / cells.cellWidth;
+	row0 = row0 < 0 ? 0 : row0 / cells.cellHeight;
+	column1 = std::min(column1 / cells.cellWidth, cells.columns - 1);
+	row1 = std::min(row1 / cells.cellHeight, cells.rows - 1);
+	if (column0 >= cells.columns || row0 >= cells.rows)
+		return;
+
+	for (int row = row0; row <= row1; row++)
+	{
+		size_t cell = (size_t)row * cells.columns + column0;
+		int begin = cells.cellStart[cell];
+		int end = cells.cellStart[cell + (column1 - column0) + 1];
+		if (begin < 0 || end < begin || (size_t)end > cells.cellBrickCount)
+			continue;
+		bricks.insert(bricks.end(), cells.cellBricks + begin, cells.cellBricks + end);
+	}
+
+	//Bricks that straddle cells show up more than once
+	std::sort(bricks.begin(), bricks.end());
+	bricks.erase(std::unique(bricks.begin(), bricks.end()), bricks.end());
+
+	//Sorted, so anything that isn't a brick is at one end or the other
+	if (!bricks.empty() && (bricks.front() < 0 || (size_t)bricks.back() >= cells.brickCount))
+	{
+		bricks.erase(std::lower_bound(bricks.begin(), bricks.end(), (int)cells.brickCount), bricks.end());
+		bricks.erase(bricks.begin(), std::lower_bound(bricks.begin(), bricks.end(), 0));
+	}
+}
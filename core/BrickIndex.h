@@ -0,0 +1,74 @@
+/*
+PROGRAM: Brick Breakers Using SDL
+PART: Broadphase for the bricks. A uniform grid of brick sized cells,
+      so the ball only gets tested against the few bricks around it.
+*/
+#ifndef BRICK_BRICKINDEX_H
+#define BRICK_BRICKINDEX_H
+
+#include <stddef.h>
+#include <vector>
+
+struct Rect;
+
+//The finished grid: where it is and which bricks each cell holds. The
+// arrays belong to the index or to whatever it was attached to.
+struct BrickIndexCells
+{
+	//Top left corner of the grid and the size of a cell
+	int originX, originY;
+	int cellWidth, cellHeight;
+
+	int columns, rows;
+	size_t brickCount;
+
+	//Cell c holds cellBricks[cellStart[c]] up to cellBricks[cellStart[c + 1]],
+	// there are columns * rows + 1 offsets and cellBrickCount entries
+	const int* cellStart;
+	const int* cellBricks;
+	size_t cellBrickCount;
+};
+
+class BrickIndex
+{
+public:
+	BrickIndex();
+
+	//Sorts every brick into the cells it covers
+	void build(const int* posX, const int* posY, size_t count, int brickWidth, int brickHeight);
+
+	//Uses a grid that was built earlier and kept somewhere else, such as
+	// a level file, without copying it. The arrays have to outlive the index.
+	void attach(const BrickIndexCells& cells);
+
+	//The grid as it is now, to save it or attach it elsewhere
+	const BrickIndexCells& getCells() const;
+
+	//Forgets every brick
+	void clear();
+
+	//Number of bricks the index was built for
+	size_t size() const;
+
+	//The area the grid covers, every brick is inside it
+	Rect getBounds() const;
+
+	//Fills bricks with every brick whose cell touches the area, lowest index
+	// first and each only once. The caller still has to do the exact test.
+	// An attached grid isn't trusted: cells whose offsets run outside it and
+	// entries that aren't bricks are left out.
+	void query(const Rect& area, std::vector<int>& bricks) const;
+
+	//Copying would leave the copy pointing into this index's arrays
+	BrickIndex(const BrickIndex&) = delete;
+	BrickIndex& operator=(const BrickIndex&) = delete;
+
+private:
+	BrickIndexCells mCells;
+
+	//The arrays of a grid built here, empty while attached
+	std::vector<int> mCellStart;
+	std::vector<int> mCellBricks;
+};
+
+#endif
@@ -0,0 +1,626 @@
+#include "Game.h"
+#include "AabbBatch.h"
+#include "Hash.h"
+#include "Profiler.h"
+#include "Random.h"
+#include "Sweep.h"
+
+#include <math.h>
+
+bool checkCollision(const Rect& a, const Rect& b)
+{
+	//The sides of the rectangles
+	int leftA, leftB;
+	int rightA, rightB;
+	int topA, topB;
+	int bottomA, bottomB;
+
+	//Calculate the sides of rect A
+	leftA = a.x;
+	rightA = a.x + a.w;
+	topA = a.y;
+	bottomA = a.y + a.h;
+
+	//Calculate the sides of rect B
+	leftB = b.x;
+	rightB = b.x + b.w;
+	topB = b.y;
+	bottomB = b.y + b.h;
+
+	//If any of the sides from A are outside of B
+	if (bottomA <= topB)
+		return false;
+
+	if (topA >= bottomB)
+		return false;
+
+	if (rightA <= leftB)
+		return false;
+
+	if (leftA >= rightB)
+		return false;
+
+	//If none of the sides from A are outside B
+	return true;
+}
+
+void Paddle::reset(int centerX)
+{
+	//Initialize the offsets
+	mPosX = centerX - (PLAYER_WIDTH / 2);
+	mPosY = SCREEN_HEIGHT - PLAYER_HEIGHT - 20;
+
+	//Initialize the velocity
+	mVelX = 0;
+
+	mPrevPosX = mPosX;
+
+	pColliderLeft = { (int)mPosX, (int)mPosY, 26, 26 };
+	pColliderMid = { (int)mPosX + 26, (int)mPosY, 26, 26 };
+	pColliderRight = { (int)mPosX + 52, (int)mPosY, 26, 26 };
+}
+
+void Paddle::move(float dt)
+{
+	//Move the paddle left or right
+	mPrevPosX = mPosX;
+	mPosX += mVelX * dt;
+
+	//If the paddle went too far to the left or right
+	if (mPosX < 0)
+		mPosX = 0;
+	if (mPosX + PLAYER_WIDTH > SCREEN_WIDTH)
+		mPosX = (float)(SCREEN_WIDTH - PLAYER_WIDTH);
+
+	//The colliders go where the paddle is now
+	pColliderLeft.x = (int)mPosX;
+	pColliderMid.x = (int)mPosX + 26;
+	pColliderRight.x = (int)mPosX + 52;
+}
+
+//Mixes a column of floats into a hash
+static uint64_t hashFloats(const std::vector<float>& values, uint64_t hash)
+{
+	if (values.empty())
+		return hash;
+	return hashBytes(&values[0], values.size() * sizeof(float), hash);
+}
+
+uint64_t hashState(const GameState& state)
+{
+	uint64_t hash = hashValue((int)state.mode, HASH_START);
+	hash = hashValue(state.tick, hash);
+	hash = hashValue(state.score, hash);
+
+	const Paddle& paddle = state.paddle;
+	hash = hashValue(paddle.mPosX, hash);
+	hash = hashValue(paddle.mPosY, hash);
+	hash = hashValue(paddle.mVelX, hash);
+
+	const BallSet& balls = state.balls;
+	hash = hashValue((uint64_t)balls.size(), hash);
+	hash = hashFloats(balls.x, hash);
+	hash = hashFloats(balls.y, hash);
+	hash = hashFloats(balls.xVel, hash);
+	hash = hashFloats(balls.yVel, hash);
+
+	//A one player game hashes the same as it did before versus games
+	if (state.players > 1)
+	{
+		hash = hashValue(state.players, hash);
+		hash = hashValue(state.paddle2.mPosX, hash);
+		hash = hashValue(state.paddle2.mVelX, hash);
+		hash = hashValue(state.score2, hash);
+		if (!balls.owner.empty())
+			hash = hashBytes(&balls.owner[0], balls.owner.size(), hash);
+	}
+
+	const BrickGrid& bricks = state.bricks;
+	hash = hashValue((uint64_t)bricks.size(), hash);
+	for (size_t i = 0; i < bricks.size(); i++)
+		hash = hashValue((unsigned char)bricks.getHealth((int)i), hash);
+	const std::vector<uint64_t>& alive = bricks.getAliveBits();
+	if (!alive.empty())
+		hash = hashBytes(&alive[0], alive.size() * sizeof(uint64_t), hash);
+	return hash;
+}
+
+Game::Game(const GameConfig& config)
+{
+	mTickRate = config.tickRate > 0 ? config.tickRate : DEFAULT_TICK_RATE;
+	mTickLength = 1.0f / mTickRate;
+	mBallCount = config.ballCount > 0 ? config.ballCount : 1;
+	mSeed = config.seed;
+	mFloorBounces = config.floorBounces;
+
+	mState.mode = GAMEMODE::MENU;
+	mState.tick = 0;
+	mState.score = 0;
+	mPrevKeys = 0;
+
+	//A versus game gives each player half of the floor to start from
+	mState.players = config.players >= MAX_PLAYERS ? MAX_PLAYERS : 1;
+	mState.score2 = 0;
+	if (mState.players > 1)
+	{
+		mState.paddle.reset(SCREEN_WIDTH / 4);
+		mState.paddle2.reset(SCREEN_WIDTH * 3 / 4);
+	}
+	else
+	{
+		mState.paddle.reset();
+		mState.paddle2.reset();
+	}
+
+	mLayout = config.layout != NULL ? config.layout : &classicLayout();
+	mState.bricks.reset(mLayout);
+
+	//Room for a busy step's events up front
+	mEvents.reserve(64);
+	mNearbyBricks.reserve(64);
+}
+
+const GameState& Game::step(const Input& input, const Input& input2)
+{
+	mEvents.clear();
+
+	//Either player can move the game on to the next screen
+	unsigned char keys = input.keys;
+	if (mState.players > 1)
+		keys |= input2.keys;
+	bool spacePressed = (keys & KEY_SPACE) && !(mPrevKeys & KEY_SPACE);
+	mPrevKeys = keys;
+
+	switch (mState.mode)
+	{
+	case GAMEMODE::MENU:
+		//reseting the player's score
+		mState.score = 0;
+		mState.score2 = 0;
+		if (spacePressed)
+		{
+			startLevel();
+			mState.mode = GAMEMODE::PLAY;
+		}
+		break;
+	case GAMEMODE::PLAY:
+		stepPlay(input, input2);
+		break;
+	case GAMEMODE::SCORE:
+	case GAMEMODE::WIN:
+		if (spacePressed)
+			mState.mode = GAMEMODE::MENU;
+		break;
+	default:
+		break;
+	}
+
+	mState.tick++;
+	return mState;
+}
+
+const GameState& Game::getState() const
+{
+	return mState;
+}
+
+void Game::save(GameSnapshot& snapshot) const
+{
+	snapshot.state = mState;
+	snapshot.prevKeys = mPrevKeys;
+}
+
+void Game::load(const GameSnapshot& snapshot)
+{
+	mState = snapshot.state;
+	mPrevKeys = snapshot.prevKeys;
+	mEvents.clear();
+}
+
+int Game::getTickRate() const
+{
+	return mTickRate;
+}
+
+float Game::getTickLength() const
+{
+	return mTickLength;
+}
+
+const std::vector<GameEvent>& Game::getEvents() const
+{
+	return mEvents;
+}
+
+const GameStats& Game::getStats() const
+{
+	return mStats;
+}
+
+void Game::resetStats()
+{
+	mStats = GameStats();
+}
+
+void Game::startLevel()
+{
+	BallSet& balls = mState.balls;
+	balls.clear();
+
+	//The first ball starts in the middle heading down and right
+	balls.add(SCREEN_WIDTH / 2, SCREEN_HEIGHT / 2, +Ball::BALL_SPEED, +Ball::BALL_SPEED);
+
+	//Any others get spread over the open space between the bricks and the paddle
+	Random random(mSeed);
+	for (int i = 1; i < mBallCount; i++)
+	{
+		float x = random.range(0.0f, (float)(SCREEN_WIDTH - Ball::BALL_SIZE));
+		float y = random.range(SCREEN_HEIGHT / 3.0f, SCREEN_HEIGHT * 0.75f);
+		float xVel = (random.next() & 1) ? +Ball::BALL_SPEED : -Ball::BALL_SPEED;
+		float yVel = (random.next() & 1) ? +Ball::BALL_SPEED : -Ball::BALL_SPEED;
+		balls.add(x, y, xVel, yVel);
+	}
+
+	mState.bricks.reset(mLayout);
+	mBallFlags.reserve(mBallCount);
+	mBrickHits.reserve(64);
+	mBrickHitOwners.reserve(64);
+}
+
+void Game::stepPlay(const Input& input, const Input& input2)
+{
+	mStats.playSteps++;
+
+	//The paddles only ever move sideways
+	Paddle* paddles[MAX_PLAYERS] = { &mState.paddle, &mState.paddle2 };
+	const Input* inputs[MAX_PLAYERS] = { &input, &input2 };
+	for (int player = 0; player < mState.players; player++)
+	{
+		Paddle& paddle = *paddles[player];
+		paddle.mVelX = 0;
+		if (inputs[player]->keys & KEY_LEFT)
+			paddle.mVelX -= Paddle::PLAYER_VEL;
+		if (inputs[player]->keys & KEY_RIGHT)
+			paddle.mVelX += Paddle::PLAYER_VEL;
+
+		//Move the Player
+		paddle.move(mTickLength);
+	}
+
+	//Ball stuff
+	moveBalls();
+
+	if (mState.balls.size() == 0)
+		mState.mode = GAMEMODE::SCORE;
+	if (mState.bricks.getAliveCount() == 0)
+		mState.mode = GAMEMODE::WIN;
+}
+
+//What the ball ran into first
+enum class CONTACT{
+	NONE,
+	WALL,
+	FLOOR,
+	PADDLE,
+	BRICK
+};
+
+Rect Game::brickZone() const
+{
+	//A pixel of slack all round, the exact pass sorts out the rest
+	Rect zone = mLayout->isFinished() ? mLayout->index.getBounds() : Rect{ 0, 0, SCREEN_WIDTH, SCREEN_HEIGHT };
+	zone.x -= 1;
+	zone.y -= 1;
+	zone.w += 2;
+	zone.h += 2;
+	return zone;
+}
+
+void Game::moveBalls()
+{
+	BallSet& balls = mState.balls;
+	size_t count = balls.size();
+	if (count == 0)
+		return;
+
+	balls.savePositions();
+	mBallFlags.resize(count);
+	mBrickHits.clear();
+	mBrickHitOwners.clear();
+
+	//Everything out in the open moves in one vectorized pass. The low zone
+	// starts a pixel above the paddle and covers the floor too.
+	float lowZoneTop = (float)mState.paddle.pColliderMid.y - 1.0f;
+	{
+		PROFILE_SCOPE(PROFILE_BALLS_FAST);
+		integrateBalls(balls, mTickLength, brickZone(), lowZoneTop, &mBallFlags[0]);
+	}
+
+	PROFILE_SCOPE(PROFILE_BALLS_EXACT);
+	bool anyLost = false;
+	for (size_t i = 0; i < count; i++)
+	{
+		if (!(mBallFlags[i] & BALL_NEAR))
+			mStats.fastMoves++;
+
+		if (mBallFlags[i] & BALL_BOUNCED)
+			pushEvent(EVENT::BOUNCE);
+		else if (mBallFlags[i] & BALL_NEAR)
+		{
+			moveBall((int)i);
+			anyLost |= (mBallFlags[i] & BALL_LOST) != 0;
+		}
+	}
+
+	//The bricks take their hits once every ball has moved
+	for (size_t i = 0; i < mBrickHits.size(); i++)
+	{
+		if (mState.bricks.damage(mBrickHits[i]))
+		{
+			if (mBrickHitOwners[i] == 1)
+				mState.score2 += BRICK_POINTS;
+			else
+				mState.score += BRICK_POINTS;
+			pushEvent(EVENT::BRICK_DESTROYED, mBrickHits[i]);
+		}
+	}
+
+	if (anyLost)
+		balls.removeLost(mBallFlags);
+}
+
+void Game::moveBall(int ball)
+{
+	BallSet& balls = mState.balls;
+	float& x = balls.x[ball];
+	float& y = balls.y[ball];
+	const float size = (float)Ball::BALL_SIZE;
+
+	//Three colliders per paddle, the first player's first
+	const Paddle* paddles[MAX_PLAYERS] = { &mState.paddle, &mState.paddle2 };
+	const Rect* paddleColliders[3 * MAX_PLAYERS];
+	int colliderCount = 0;
+	for (int player = 0; player < mState.players; player++)
+	{
+		paddleColliders[colliderCount++] = &paddles[player]->pColliderMid;
+		paddleColliders[colliderCount++] = &paddles[player]->pColliderLeft;
+		paddleColliders[colliderCount++] = &paddles[player]->pColliderRight;
+	}
+
+	//A paddle that slid into the ball still knocks it back up. When both
+	// paddles are touching it, the one nearer the ball gets it.
+	if (balls.yVel[ball] > 0)
+	{
+		Rect ballRect = balls.getRect(ball);
+		int touching[MAX_PLAYERS] = { -1, -1 };
+		for (int i = 0; i < colliderCount; i++)
+		{
+			if (touching[i / 3] < 0 && checkCollision(ballRect, *paddleColliders[i]))
+				touching[i / 3] = i;
+		}
+		int chosen = touching[0];
+		if (touching[1] >= 0 && (chosen < 0 || nearerPaddle(ball) == 1))
+			chosen = touching[1];
+		if (chosen >= 0)
+			bouncePaddle(ball, chosen / 3, paddleColliders[chosen]);
+	}
+
+	//Follow the ball from one impact to the next until the step is used up
+	float timeLeft = 1.0f;
+	for (int impact = 0; impact < MAX_IMPACTS && timeLeft > 0.0f; impact++)
+	{
+		float dx = balls.xVel[ball] * mTickLength * timeLeft;
+		float dy = balls.yVel[ball] * mTickLength * timeLeft;
+
+		SweepHit first = { 1.0f, 0, 0 };
+		CONTACT contact = CONTACT::NONE;
+		int target = -1;
+
+		//The walls, the ceiling and the floor
+		if (dx < 0.0f && x / -dx < first.time)
+		{
+			first = { x > 0.0f ? x / -dx : 0.0f, 1, 0 };
+			contact = CONTACT::WALL;
+		}
+		if (dx > 0.0f && (SCREEN_WIDTH - size - x) / dx < first.time)
+		{
+			first = { x < SCREEN_WIDTH - size ? (SCREEN_WIDTH - size - x) / dx : 0.0f, -1, 0 };
+			contact = CONTACT::WALL;
+		}
+		if (dy < 0.0f && y / -dy < first.time)
+		{
+			first = { y > 0.0f ? y / -dy : 0.0f, 0, 1 };
+			contact = CONTACT::WALL;
+		}
+		if (dy > 0.0f && (SCREEN_HEIGHT - size - y) / dy < first.time)
+		{
+			first = { y < SCREEN_HEIGHT - size ? (SCREEN_HEIGHT - size - y) / dy : 0.0f, 0, -1 };
+			contact = CONTACT::FLOOR;
+		}
+
+		//The paddle only catches a ball on its way down. Each player's
+		// first collider is found, and if both paddles get there at the
+		// same time the one nearer the ball has it.
+		SweepHit hit;
+		if (dy > 0.0f)
+		{
+			mStats.sweepTests += colliderCount;
+			int paddleTarget[MAX_PLAYERS] = { -1, -1 };
+			SweepHit paddleHit[MAX_PLAYERS];
+			for (int i = 0; i < colliderCount; i++)
+			{
+				int player = i / 3;
+				if (sweepBox(x, y, size, size, dx, dy, *paddleColliders[i], hit) && hit.time < first.time
+					&& (paddleTarget[player] < 0 || hit.time < paddleHit[player].time))
+				{
+					paddleHit[player] = hit;
+					paddleTarget[player] = i;
+				}
+			}
+
+			int chosen = paddleTarget[0] >= 0 ? 0 : -1;
+			if (paddleTarget[1] >= 0 && (chosen < 0 || paddleHit[1].time < paddleHit[0].time
+				|| (paddleHit[1].time == paddleHit[0].time && nearerPaddle(ball) == 1)))
+				chosen = 1;
+			if (chosen >= 0)
+			{
+				first = paddleHit[chosen];
+				contact = CONTACT::PADDLE;
+				target = paddleTarget[chosen];
+			}
+		}
+
+		//Standing bricks along the way, the lowest index wins a tie
+		int brick = firstBrickHit(x, y, dx, dy, first.time, hit);
+		if (brick >= 0)
+		{
+			first = hit;
+			contact = CONTACT::BRICK;
+			target = brick;
+		}
+
+		//Move up to the impact, or all the way if there isn't one
+		x += dx * first.time;
+		y += dy * first.time;
+		timeLeft *= 1.0f - first.time;
+
+		switch (contact)
+		{
+		case CONTACT::NONE:
+			timeLeft = 0.0f;
+			break;
+		case CONTACT::WALL:
+			pushEvent(EVENT::BOUNCE);
+			reflectBall(ball, first);
+			break;
+		case CONTACT::FLOOR:
+			if (mFloorBounces)
+			{
+				pushEvent(EVENT::BOUNCE);
+				reflectBall(ball, first);
+				break;
+			}
+			mBallFlags[ball] |= BALL_LOST;
+			timeLeft = 0.0f;
+			break;
+		case CONTACT::PADDLE:
+			bouncePaddle(ball, target / 3, paddleColliders[target]);
+			break;
+		case CONTACT::BRICK:
+			pushEvent(EVENT::BOUNCE, target);
+			reflectBall(ball, first);
+			mBrickHits.push_back(target);
+			mBrickHitOwners.push_back(balls.owner[ball]);
+			break;
+		}
+	}
+}
+
+int Game::firstBrickHit(float x, float y, float dx, float dy, float before, SweepHit& hit)
+{
+	const float size = (float)Ball::BALL_SIZE;
+	const BrickGrid& bricks = mState.bricks;
+	if (bricks.size() == 0)
+		return -1;
+
+	//Everything the ball could touch on this move
+	Rect bounds = sweptBounds(x, y, size, size, dx, dy);
+
+	int first = -1;
+	SweepHit candidate;
+	if (mLayout->isFinished())
+	{
+		//Only the bricks in the cells along the way need the exact test
+		mLayout->index.query(bounds, mNearbyBricks);
+		mStats.brickCandidates += mNearbyBricks.size();
+		for (size_t i = 0; i < mNearbyBricks.size(); i++)
+		{
+			int brick = mNearbyBricks[i];
+			if (!bricks.isAlive(brick))
+				continue;
+
+			mStats.sweepTests++;
+			if (sweepBox(x, y, size, size, dx, dy, bricks.getRect(brick), candidate) && candidate.time < before)
+			{
+				before = candidate.time;
+				hit = candidate;
+				first = brick;
+			}
+		}
+	}
+	else
+	{
+		//No broadphase, test every brick against the swept bounds in one
+		// batch and only sweep the standing bricks that touch them
+		const std::vector<uint64_t>& alive = bricks.getAliveBits();
+		mHitBits.resize(alive.size());
+		overlapBatch(bounds, mLayout->posX, mLayout->posY, mLayout->brickWidth, mLayout->brickHeight, bricks.size(), &mHitBits[0]);
+		for (size_t word = 0; word < alive.size(); word++)
+		{
+			uint64_t bits = mHitBits[word] & alive[word];
+			while (bits != 0)
+			{
+				int brick = (int)(word * 64 + lowestBit(bits));
+				bits &= bits - 1;
+				mStats.brickCandidates++;
+				mStats.sweepTests++;
+				if (sweepBox(x, y, size, size, dx, dy, bricks.getRect(brick), candidate) && candidate.time < before)
+				{
+					before = candidate.time;
+					hit = candidate;
+					first = brick;
+				}
+			}
+		}
+	}
+
+	return first;
+}
+
+void Game::reflectBall(int ball, const SweepHit& hit)
+{
+	BallSet& balls = mState.balls;
+
+	//Send the ball away from the surface it hit
+	if (hit.normalX != 0)
+		balls.xVel[ball] = hit.normalX * fabsf(balls.xVel[ball]);
+	if (hit.normalY != 0)
+		balls.yVel[ball] = hit.normalY * fabsf(balls.yVel[ball]);
+}
+
+int Game::nearerPaddle(int ball) const
+{
+	if (mState.players < 2)
+		return 0;
+
+	float ballCenter = mState.balls.x[ball] + Ball::BALL_SIZE / 2.0f;
+	float first = fabsf(mState.paddle.mPosX + Paddle::PLAYER_WIDTH / 2.0f - ballCenter);
+	float second = fabsf(mState.paddle2.mPosX + Paddle::PLAYER_WIDTH / 2.0f - ballCenter);
+	if (first != second)
+		return first < second ? 0 : 1;
+
+	//Right in the middle, the players take turns step by step
+	return (int)((mState.tick + ball) & 1);
+}
+
+void Game::bouncePaddle(int ball, int player, const Rect* collider)
+{
+	BallSet& balls = mState.balls;
+	const Paddle& paddle = player == 1 ? mState.paddle2 : mState.paddle;
+
+	pushEvent(EVENT::BOUNCE);
+	balls.yVel[ball] = -fabsf(balls.yVel[ball]);
+	balls.owner[ball] = (unsigned char)player;
+
+	//The ends of the paddle send the ball back out their way
+	if (collider == &paddle.pColliderLeft)
+		balls.xVel[ball] = -fabsf(balls.xVel[ball]);
+	else if (collider == &paddle.pColliderRight)
+		balls.xVel[ball] = fabsf(balls.xVel[ball]);
+}
+
+void Game::pushEvent(EVENT type, int brick)
+{
+	GameEvent event = { type, brick };
+	mEvents.push_back(event);
+}
@@ -0,0 +1,290 @@
+/*
+PROGRAM: Brick Breakers Using SDL
+PART: The game rules. Nothing in here touches SDL, so a game can be
+      stepped without a window, a renderer or an audio device.
+*/
+#ifndef BRICK_GAME_H
+#define BRICK_GAME_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include "BallSet.h"
+#include "BrickGrid.h"
+#include "Sweep.h"
+
+//Screen Dimensions
+const int SCREEN_WIDTH = 800;
+const int SCREEN_HEIGHT = 600;
+
+//Steps per second the rules are tuned for
+const int DEFAULT_TICK_RATE = 60;
+
+//Most paddles in one game, two in a versus game
+const int MAX_PLAYERS = 2;
+
+//Game Modes
+enum class GAMEMODE{
+	MENU,
+	EXIT,
+	PLAY,
+	SCORE,
+	WIN
+};
+
+//The keys the rules care about, one bit each
+enum InputKey
+{
+	KEY_LEFT = 1 << 0,
+	KEY_RIGHT = 1 << 1,
+	KEY_UP = 1 << 2,
+	KEY_DOWN = 1 << 3,
+	KEY_SPACE = 1 << 4
+};
+
+//The keys that are held down during one step
+struct Input
+{
+	unsigned char keys = 0;
+};
+
+//Things that happened during a step that the frontend may want to play or show
+enum class EVENT{
+	BOUNCE,
+	BRICK_DESTROYED
+};
+
+struct GameEvent
+{
+	EVENT type;
+
+	//The brick the event is about, -1 if none
+	int brick;
+};
+
+//A plain rectangle so the rules don't depend on SDL_Rect
+struct Rect
+{
+	int x, y, w, h;
+};
+
+//True if the two rectangles overlap
+bool checkCollision(const Rect& a, const Rect& b);
+
+//The paddle that the player moves left and right
+struct Paddle
+{
+	//The dimensions of the paddle
+	static const int PLAYER_WIDTH = 80;
+	static const int PLAYER_HEIGHT = 40;
+
+	//Maximum axis velocity of the paddle, in pixels per second
+	static constexpr float PLAYER_VEL = 540.0f;
+
+	//Puts the paddle at the bottom of the screen, centered on centerX
+	void reset(int centerX = SCREEN_WIDTH / 2);
+
+	//Moves the paddle with its current velocity for dt seconds
+	void move(float dt);
+
+	//The X and Y offsets of the paddle
+	float mPosX, mPosY;
+
+	//Where the paddle was before the last step, for drawing between steps
+	float mPrevPosX;
+
+	//The velocity of the paddle
+	float mVelX;
+
+	//The rectangular colliders for the paddle
+	Rect pColliderLeft;
+	Rect pColliderMid;
+	Rect pColliderRight;
+};
+
+//What every ball has in common, the balls themselves live in a BallSet
+struct Ball
+{
+	static const int BALL_SIZE = 20;
+
+	//Speed along each axis, in pixels per second
+	static constexpr float BALL_SPEED = 180.0f;
+};
+
+//How a game is set up
+struct GameConfig
+{
+	//Steps per second
+	int tickRate = DEFAULT_TICK_RATE;
+
+	//The bricks every game starts with, it has to outlive the game. The
+	// classic level is used if there is none.
+	const BrickLayout* layout = NULL;
+
+	//Balls put in play at the start of every game
+	int ballCount = 1;
+
+	//Decides where the extra balls start and which way they go
+	unsigned int seed = 1;
+
+	//Balls bounce off the floor instead of being lost, so games only end
+	// when the bricks run out. For benchmarks and long unattended runs.
+	bool floorBounces = false;
+
+	//Paddles in play. With two it is a versus game, every brick scores
+	// for the player whose paddle last sent the ball at it.
+	int players = 1;
+};
+
+//Work the rules have done, counted as they go for benchmarks
+struct GameStats
+{
+	//Steps taken during play
+	uint64_t playSteps = 0;
+
+	//Ball moves the vectorized pass finished without any exact test
+	uint64_t fastMoves = 0;
+
+	//Swept tests of a ball against a brick or a paddle collider
+	uint64_t sweepTests = 0;
+
+	//Bricks the broadphase handed over for an exact test
+	uint64_t brickCandidates = 0;
+};
+
+//Everything the rules need to know about a game
+struct GameState
+{
+	GAMEMODE mode;
+
+	//Number of steps taken so far
+	unsigned int tick;
+
+	int score;
+
+	Paddle paddle;
+	BallSet balls;
+	BrickGrid bricks;
+
+	//Paddles in play, the second one and its score only count in a versus game
+	int players;
+	Paddle paddle2;
+	int score2;
+};
+
+//Everything needed to put a game back the way it was before some step.
+// Saving into the same snapshot again reuses its storage.
+struct GameSnapshot
+{
+	GameState state;
+	unsigned char prevKeys = 0;
+};
+
+//A fingerprint of everything in a state, two games that played out the
+// same have the same hash
+uint64_t hashState(const GameState& state);
+
+class Game
+{
+public:
+	//Points given for every brick destroyed
+	static const int BRICK_POINTS = 100;
+
+	//Most surfaces a ball can bounce off in one step
+	static const int MAX_IMPACTS = 8;
+
+	//Starts on the menu
+	Game(const GameConfig& config = GameConfig());
+
+	//Advances the rules by one step with the given keys held down, the
+	// second player's keys only matter in a versus game
+	const GameState& step(const Input& input, const Input& input2 = Input());
+
+	//Copies the game out to a snapshot, or puts it back the way a snapshot
+	// has it. The events and the stats are left alone.
+	void save(GameSnapshot& snapshot) const;
+	void load(const GameSnapshot& snapshot);
+
+	const GameState& getState() const;
+
+	//Gets the steps per second and the seconds covered by one step
+	int getTickRate() const;
+	float getTickLength() const;
+
+	//Gets what happened during the last step
+	const std::vector<GameEvent>& getEvents() const;
+
+	//Gets the work done since the game was made or the stats were reset
+	const GameStats& getStats() const;
+	void resetStats();
+
+private:
+	//Puts the balls and every brick back for a new game
+	void startLevel();
+
+	//One step of actual play
+	void stepPlay(const Input& input, const Input& input2);
+
+	//Moves every ball, the quick way when nothing is near and the exact way otherwise
+	void moveBalls();
+
+	//Moves one ball through the step from one impact to the next
+	void moveBall(int ball);
+
+	//The standing brick a move of a ball touches first, if it is
+	// before the given time. -1 if there is none.
+	int firstBrickHit(float x, float y, float dx, float dy, float before, SweepHit& hit);
+
+	//Sends a ball away from a surface it hit
+	void reflectBall(int ball, const SweepHit& hit);
+
+	//The player whose paddle's center is nearer a ball's, for when both
+	// paddles touch it at once
+	int nearerPaddle(int ball) const;
+
+	//Knocks a ball back up off one of a player's paddle colliders
+	void bouncePaddle(int ball, int player, const Rect* collider);
+
+	//Where the region around the bricks is, balls outside it skip the brick tests
+	Rect brickZone() const;
+
+	void pushEvent(EVENT type, int brick = -1);
+
+	GameState mState;
+	std::vector<GameEvent> mEvents;
+
+	int mTickRate;
+	float mTickLength;
+
+	//The bricks every new game starts with
+	const BrickLayout* mLayout;
+
+	int mBallCount;
+	unsigned int mSeed;
+	bool mFloorBounces;
+
+	GameStats mStats;
+
+	//Bricks near a ball, reused every step
+	std::vector<int> mNearbyBricks;
+
+	//Which bricks a ball touches when there is no broadphase
+	std::vector<uint64_t> mHitBits;
+
+	//What the fast pass found out about each ball
+	std::vector<unsigned char> mBallFlags;
+
+	//Bricks hit this step, in ball order. Every ball sees the bricks as
+	// they stood at the start of the step, the damage lands afterwards,
+	// so balls hitting the same brick together always play out the same.
+	std::vector<int> mBrickHits;
+
+	//The player each of those hits scores for
+	std::vector<unsigned char> mBrickHitOwners;
+
+	//Keys held during the previous step, so presses can be told apart from holds
+	unsigned char mPrevKeys;
+};
+
+#endif
@@ -0,0 +1,34 @@
+/*
+PROGRAM: Brick Breakers Using SDL
+PART: A 64 bit FNV-1a hash, for telling states and layouts apart
+      without comparing them field by field.
+*/
+#ifndef BRICK_HASH_H
+#define BRICK_HASH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+//What a hash starts from before any bytes go in
+const uint64_t HASH_START = 14695981039346656037ULL;
+
+//Mixes bytes into a hash and returns the new hash
+inline uint64_t hashBytes(const void* data, size_t size, uint64_t hash = HASH_START)
+{
+	const unsigned char* bytes = (const unsigned char*)data;
+	for (size_t i = 0; i < size; i++)
+	{
+		hash ^= bytes[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+//Mixes one plain value into a hash
+template <typename T>
+inline uint64_t hashValue(const T& value, uint64_t hash)
+{
+	return hashBytes(&value, sizeof(value), hash);
+}
+
+#endif
@@ -0,0 +1,278 @@
+#include "LevelFile.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+//What byteOrder reads as on a machine with the same byte order as the writer
+static const uint32_t LEVEL_BYTE_ORDER = 0x01020304;
+
+static_assert(sizeof(LevelHeader) == 80, "LevelHeader must not have padding");
+
+//True if a section of count entries of the given size fits in the file
+// at an aligned offset
+static bool sectionFits(uint32_t offset, uint64_t count, size_t entrySize, size_t fileSize)
+{
+	if (offset % entrySize != 0 || offset < sizeof(LevelHeader))
+		return false;
+	return offset <= fileSize && count * entrySize <= fileSize - offset;
+}
+
+LevelFile::LevelFile()
+{
+}
+
+bool LevelFile::open(const char* path)
+{
+	close();
+
+	if (!mFile.open(path))
+		return false;
+
+	const unsigned char* data = mFile.getData();
+	size_t size = mFile.getSize();
+
+	LevelHeader header;
+	if (size < sizeof(header))
+	{
+		printf("%s is too short to be a level\n", path);
+		close();
+		return false;
+	}
+	memcpy(&header, data, sizeof(header));
+
+	if (memcmp(header.magic, "BRKL", 4) != 0)
+	{
+		printf("%s is not a level\n", path);
+		close();
+		return false;
+	}
+	if (header.byteOrder != LEVEL_BYTE_ORDER)
+	{
+		printf("%s was written on a machine with a different byte order\n", path);
+		close();
+		return false;
+	}
+	if (header.version != LEVEL_VERSION || header.headerSize != sizeof(LevelHeader))
+	{
+		printf("%s is level version %u, this build reads version %u\n", path, header.version, LEVEL_VERSION);
+		close();
+		return false;
+	}
+
+	//The grid and every section have to make sense before anything is read
+	// out of them. What the grid holds is only checked where it is used, by
+	// BrickIndex::query(), so opening doesn't read through it.
+	uint64_t cellCount = (uint64_t)(header.columns > 0 ? header.columns : 0) * (uint64_t)(header.rows > 0 ? header.rows : 0);
+	bool valid = header.brickWidth > 0 && header.brickHeight > 0
+		&& header.cellWidth > 0 && header.cellHeight > 0
+		&& header.columns >= 0 && header.rows >= 0
+		&& (header.brickCount == 0 || cellCount > 0)
+		&& sectionFits(header.posXOffset, header.brickCount, sizeof(int32_t), size)
+		&& sectionFits(header.posYOffset, header.brickCount, sizeof(int32_t), size)
+		&& sectionFits(header.typeOffset, header.brickCount, 1, size)
+		&& sectionFits(header.healthOffset, header.brickCount, 1, size)
+		&& sectionFits(header.cellStartOffset, cellCount + 1, sizeof(int32_t), size)
+		&& sectionFits(header.cellBricksOffset, header.cellBrickCount, sizeof(int32_t), size);
+
+	if (!valid)
+	{
+		printf("%s is damaged\n", path);
+		close();
+		return false;
+	}
+
+	BrickIndexCells cells;
+	cells.originX = header.originX;
+	cells.originY = header.originY;
+	cells.cellWidth = header.cellWidth;
+	cells.cellHeight = header.cellHeight;
+	cells.columns = header.columns;
+	cells.rows = header.rows;
+	cells.brickCount = header.brickCount;
+	cells.cellStart = (const int*)(data + header.cellStartOffset);
+	cells.cellBricks = (const int*)(data + header.cellBricksOffset);
+	cells.cellBrickCount = header.cellBrickCount;
+
+	mLayout.attach(header.brickCount, header.brickWidth, header.brickHeight,
+		(const int*)(data + header.posXOffset), (const int*)(data + header.posYOffset),
+		data + header.typeOffset, data + header.healthOffset, cells);
+	return true;
+}
+
+void LevelFile::close()
+{
+	mLayout.clear();
+	mFile.close();
+}
+
+const BrickLayout& LevelFile::getLayout() const
+{
+	return mLayout;
+}
+
+bool loadLevelText(const char* path, BrickLayout& layout)
+{
+	FILE* file = fopen(path, "r");
+	if (file == NULL)
+	{
+		printf("Unable to open %s!\n", path);
+		return false;
+	}
+
+	layout.clear();
+	layout.brickWidth = BrickLayout::DEFAULT_BRICK_WIDTH;
+	layout.brickHeight = BrickLayout::DEFAULT_BRICK_HEIGHT;
+
+	bool success = true;
+	char line[256];
+	for (int lineNumber = 1; success && fgets(line, sizeof(line), file) != NULL; lineNumber++)
+	{
+		//Everything after a # is a comment
+		char* comment = strchr(line, '#');
+		if (comment != NULL)
+			*comment = '\0';
+
+		char word[16];
+		int values[6];
+		if (sscanf(line, "%15s", word) != 1)
+			continue;
+
+		if (strcmp(word, "size") == 0)
+		{
+			if (sscanf(line, "%*s %d %d", &values[0], &values[1]) != 2 || values[0] <= 0 || values[1] <= 0)
+				success = false;
+			else if (layout.size() > 0)
+			{
+				printf("%s:%d: size has to come before the bricks\n", path, lineNumber);
+				success = false;
+				break;
+			}
+			else
+			{
+				layout.brickWidth = values[0];
+				layout.brickHeight = values[1];
+			}
+		}
+		else if (strcmp(word, "brick") == 0)
+		{
+			//Type and health are optional
+			values[2] = 0;
+			values[3] = 1;
+			int count = sscanf(line, "%*s %d %d %d %d", &values[0], &values[1], &values[2], &values[3]);
+			if (count < 2 || values[2] < 0 || values[2] > 255 || values[3] < 1 || values[3] > 255)
+				success = false;
+			else
+				layout.addBrick(values[0], values[1], (unsigned char)values[2], (unsigned char)values[3]);
+		}
+		else if (strcmp(word, "rows") == 0)
+		{
+			if (sscanf(line, "%*s %d %d %d %d %d %d", &values[0], &values[1], &values[2], &values[3], &values[4], &values[5]) != 6
+				|| values[0] < 0 || values[1] <= 0)
+				success = false;
+			else
+				layout.addRows(values[0], values[1], values[2], values[3], values[4], values[5]);
+		}
+		else
+			success = false;
+
+		if (!success)
+			printf("%s:%d: can't read \"%s\"\n", path, lineNumber, word);
+	}
+	fclose(file);
+
+	if (!success)
+	{
+		layout.clear();
+		return false;
+	}
+
+	layout.finish();
+	return true;
+}
+
+//Pads the file with zeros up to the next section boundary
+static void padTo(FILE* file, uint32_t offset)
+{
+	static const char zeros[LEVEL_ALIGNMENT] = { 0 };
+	long at = ftell(file);
+	if (at >= 0 && (uint32_t)at < offset)
+		fwrite(zeros, 1, offset - (uint32_t)at, file);
+}
+
+//Where the next section starts after one that ends at the given offset
+static uint32_t nextSection(uint64_t end)
+{
+	return (uint32_t)((end + LEVEL_ALIGNMENT - 1) / LEVEL_ALIGNMENT * LEVEL_ALIGNMENT);
+}
+
+bool saveLevel(const char* path, const BrickLayout& layout)
+{
+	if (!layout.isFinished())
+	{
+		printf("Unable to save %s, the layout has no broadphase\n", path);
+		return false;
+	}
+
+	const BrickIndexCells& cells = layout.index.getCells();
+	uint32_t count = (uint32_t)layout.size();
+	uint64_t cellCount = (uint64_t)cells.columns * cells.rows;
+	uint32_t cellBrickCount = count > 0 ? (uint32_t)cells.cellStart[cellCount] : 0;
+
+	LevelHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, "BRKL", 4);
+	header.byteOrder = LEVEL_BYTE_ORDER;
+	header.version = LEVEL_VERSION;
+	header.headerSize = sizeof(LevelHeader);
+	header.brickCount = count;
+	header.brickWidth = layout.brickWidth;
+	header.brickHeight = layout.brickHeight;
+	header.originX = cells.originX;
+	header.originY = cells.originY;
+	header.cellWidth = cells.cellWidth;
+	header.cellHeight = cells.cellHeight;
+	header.columns = cells.columns;
+	header.rows = cells.rows;
+	header.cellBrickCount = cellBrickCount;
+
+	//An empty layout still gets a grid with one offset
+	static const int noCells[1] = { 0 };
+	const int* cellStart = count > 0 ? cells.cellStart : noCells;
+
+	header.posXOffset = nextSection(sizeof(LevelHeader));
+	header.posYOffset = nextSection(header.posXOffset + (uint64_t)count * sizeof(int32_t));
+	header.typeOffset = nextSection(header.posYOffset + (uint64_t)count * sizeof(int32_t));
+	header.healthOffset = nextSection(header.typeOffset + (uint64_t)count);
+	header.cellStartOffset = nextSection(header.healthOffset + (uint64_t)count);
+	header.cellBricksOffset = nextSection(header.cellStartOffset + (cellCount + 1) * sizeof(int32_t));
+
+	FILE* file = fopen(path, "wb");
+	if (file == NULL)
+	{
+		printf("Unable to create %s!\n", path);
+		return false;
+	}
+
+	fwrite(&header, sizeof(header), 1, file);
+	padTo(file, header.posXOffset);
+	fwrite(layout.posX, sizeof(int32_t), count, file);
+	padTo(file, header.posYOffset);
+	fwrite(layout.posY, sizeof(int32_t), count, file);
+	padTo(file, header.typeOffset);
+	fwrite(layout.type, 1, count, file);
+	padTo(file, header.healthOffset);
+	fwrite(layout.health, 1, count, file);
+	padTo(file, header.cellStartOffset);
+	fwrite(cellStart, sizeof(int32_t), (size_t)cellCount + 1, file);
+	padTo(file, header.cellBricksOffset);
+	fwrite(cells.cellBricks, sizeof(int32_t), cellBrickCount, file);
+
+	bool success = !ferror(file);
+	if (fclose(file) != 0 || !success)
+	{
+		printf("Unable to write %s!\n", path);
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,91 @@
+/*
+PROGRAM: Brick Breakers Using SDL
+PART: Levels on disk. The binary format is laid out exactly like a
+      BrickLayout in memory, so a level is mapped and played where it
+      lies without reading it brick by brick. Levels are written in a
+      text format and converted.
+*/
+#ifndef BRICK_LEVELFILE_H
+#define BRICK_LEVELFILE_H
+
+#include <stdint.h>
+
+#include "BrickGrid.h"
+#include "MappedFile.h"
+
+//Version of the binary layout this build reads and writes, any change to
+// LevelHeader or to the sections needs a new one
+const uint32_t LEVEL_VERSION = 1;
+
+//Every section starts on a boundary this size, so the columns can be
+// read in place with aligned loads
+const uint32_t LEVEL_ALIGNMENT = 64;
+
+//Start of a binary level. It is followed by the sections it points to:
+// the brick columns and the finished broadphase grid.
+struct LevelHeader
+{
+	//Always "BRKL"
+	char magic[4];
+
+	//0x01020304 as written by the machine that made the file, tells
+	// files from a machine with the other byte order apart
+	uint32_t byteOrder;
+
+	uint32_t version;
+	uint32_t headerSize;
+
+	uint32_t brickCount;
+	int32_t brickWidth;
+	int32_t brickHeight;
+
+	//The broadphase grid, see BrickIndexCells
+	int32_t originX;
+	int32_t originY;
+	int32_t cellWidth;
+	int32_t cellHeight;
+	int32_t columns;
+	int32_t rows;
+	uint32_t cellBrickCount;
+
+	//Where each section starts, in bytes from the start of the file
+	uint32_t posXOffset;
+	uint32_t posYOffset;
+	uint32_t typeOffset;
+	uint32_t healthOffset;
+	uint32_t cellStartOffset;
+	uint32_t cellBricksOffset;
+};
+
+//A binary level mapped into memory with a layout pointing into it
+class LevelFile
+{
+public:
+	LevelFile();
+
+	//Maps a binary level and points the layout at it. The header is checked
+	// and every section has to fit in the file. The broadphase grid is used
+	// as it is, the index skips whatever in it doesn't point at a brick.
+	bool open(const char* path);
+
+	//Unmaps the level, the layout is left empty
+	void close();
+
+	//The level's bricks, valid until the next open() or close()
+	const BrickLayout& getLayout() const;
+
+private:
+	MappedFile mFile;
+	BrickLayout mLayout;
+};
+
+//Reads a level written in the text format into a layout and finishes it.
+// Lines are "size <width> <height>", "brick <x> <y> [type] [health]" or
+// "rows <count> <columns> <startX> <startY> <stepX> <stepY>", and # starts
+// a comment.
+bool loadLevelText(const char* path, BrickLayout& layout);
+
+//Writes a finished layout out as a binary level
+bool saveLevel(const char* path, const BrickLayout& layout);
+
+#endif
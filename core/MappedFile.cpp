@@ -0,0 +1,136 @@
+#include "MappedFile.h"
+
+#include <stdio.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile()
+{
+	mData = NULL;
+	mSize = 0;
+#ifdef _WIN32
+	mFile = NULL;
+	mMapping = NULL;
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+	close();
+}
+
+#ifdef _WIN32
+
+bool MappedFile::open(const char* path)
+{
+	close();
+
+	HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		printf("Unable to open %s! Error: %lu\n", path, GetLastError());
+		return false;
+	}
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+	{
+		printf("Unable to map %s, it is empty or unreadable\n", path);
+		CloseHandle(file);
+		return false;
+	}
+
+	HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	void* view = mapping != NULL ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+	if (view == NULL)
+	{
+		printf("Unable to map %s! Error: %lu\n", path, GetLastError());
+		if (mapping != NULL)
+			CloseHandle(mapping);
+		CloseHandle(file);
+		return false;
+	}
+
+	mFile = file;
+	mMapping = mapping;
+	mData = (const unsigned char*)view;
+	mSize = (size_t)size.QuadPart;
+	return true;
+}
+
+void MappedFile::close()
+{
+	if (mData != NULL)
+		UnmapViewOfFile(mData);
+	if (mMapping != NULL)
+		CloseHandle((HANDLE)mMapping);
+	if (mFile != NULL)
+		CloseHandle((HANDLE)mFile);
+	mData = NULL;
+	mSize = 0;
+	mFile = NULL;
+	mMapping = NULL;
+}
+
+#else
+
+bool MappedFile::open(const char* path)
+{
+	close();
+
+	int file = ::open(path, O_RDONLY);
+	if (file < 0)
+	{
+		printf("Unable to open %s!\n", path);
+		return false;
+	}
+
+	struct stat info;
+	if (fstat(file, &info) != 0 || info.st_size == 0)
+	{
+		printf("Unable to map %s, it is empty or unreadable\n", path);
+		::close(file);
+		return false;
+	}
+
+	//The mapping stays valid after the descriptor is closed
+	void* view = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+	::close(file);
+	if (view == MAP_FAILED)
+	{
+		printf("Unable to map %s!\n", path);
+		return false;
+	}
+
+	mData = (const unsigned char*)view;
+	mSize = (size_t)info.st_size;
+	return true;
+}
+
+void MappedFile::close()
+{
+	if (mData != NULL)
+		munmap((void*)mData, mSize);
+	mData = NULL;
+	mSize = 0;
+}
+
+#endif
+
+const unsigned char* MappedFile::getData() const
+{
+	return mData;
+}
+
+size_t MappedFile::getSize() const
+{
+	return mSize;
+}
@@ -0,0 +1,45 @@
+/*
+PROGRAM: Brick Breakers Using SDL
+PART: A read only file mapped into memory, so data on disk can be used
+      where it lies instead of being read and copied.
+*/
+#ifndef BRICK_MAPPEDFILE_H
+#define BRICK_MAPPEDFILE_H
+
+#include <stddef.h>
+
+class MappedFile
+{
+public:
+	//Initializes variables
+	MappedFile();
+
+	//Unmaps the file
+	~MappedFile();
+
+	//Maps the whole file, false if it can't be opened or is empty
+	bool open(const char* path);
+
+	//Unmaps the file
+	void close();
+
+	//The bytes of the file, NULL if nothing is mapped
+	const unsigned char* getData() const;
+	size_t getSize() const;
+
+	//Copying would unmap the file twice
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+private:
+	const unsigned char* mData;
+	size_t mSize;
+
+#ifdef _WIN32
+	//The handles that keep the view alive
+	void* mFile;
+	void* mMapping;
+#endif
+};
+
+#endif
@@ -0,0 +1,153 @@
+#include "ParticlePool.h"
+#include "Game.h"
+#include "Simd.h"
+
+ParticlePool::ParticlePool(size_t capacity)
+{
+	mCapacity = capacity;
+	mCount = 0;
+	mDropped = 0;
+	mDeadCount = 0;
+
+	x.resize(capacity);
+	y.resize(capacity);
+	xVel.resize(capacity);
+	yVel.resize(capacity);
+	life.resize(capacity);
+	maxLife.resize(capacity);
+	color.resize(capacity);
+	mDead.resize(capacity);
+}
+
+void ParticlePool::clear()
+{
+	mCount = 0;
+}
+
+bool ParticlePool::spawn(float posX, float posY, float velX, float velY, float lifeTime, unsigned char particleColor)
+{
+	if (mCount >= mCapacity)
+	{
+		mDropped++;
+		return false;
+	}
+
+	size_t i = mCount++;
+	x[i] = posX;
+	y[i] = posY;
+	xVel[i] = velX;
+	yVel[i] = velY;
+	life[i] = lifeTime;
+	maxLife[i] = lifeTime;
+	color[i] = particleColor;
+	return true;
+}
+
+int ParticlePool::spawnBurst(const Rect& area, int count, unsigned char particleColor, Random& random)
+{
+	int spawned = 0;
+	for (int i = 0; i < count; i++)
+	{
+		float posX = random.range((float)area.x, (float)(area.x + area.w));
+		float posY = random.range((float)area.y, (float)(area.y + area.h));
+
+		//Away from the middle of the brick, and mostly upwards
+		float velX = (posX - (area.x + area.w * 0.5f)) * 4.0f + random.range(-60.0f, 60.0f);
+		float velY = random.range(-260.0f, -40.0f);
+		if (!spawn(posX, posY, velX, velY, random.range(0.6f, 1.4f), particleColor))
+		{
+			//Nothing else will fit either
+			mDropped += count - i - 1;
+			break;
+		}
+		spawned++;
+	}
+	return spawned;
+}
+
+void ParticlePool::update(float dt)
+{
+	const float fallDv = GRAVITY * dt;
+	const float bottom = (float)SCREEN_HEIGHT;
+	size_t i = 0;
+	mDeadCount = 0;
+
+#ifdef BRICK_HAVE_SSE2
+	const __m128 vdt = _mm_set1_ps(dt);
+	const __m128 vfallDv = _mm_set1_ps(fallDv);
+	const __m128 vbottom = _mm_set1_ps(bottom);
+	const __m128 zero = _mm_setzero_ps();
+
+	for (; i + 4 <= mCount; i += 4)
+	{
+		__m128 vx = _mm_loadu_ps(&xVel[i]);
+		__m128 vy = _mm_loadu_ps(&yVel[i]);
+		__m128 px = _mm_add_ps(_mm_loadu_ps(&x[i]), _mm_mul_ps(vx, vdt));
+		__m128 py = _mm_add_ps(_mm_loadu_ps(&y[i]), _mm_mul_ps(vy, vdt));
+		__m128 left = _mm_sub_ps(_mm_loadu_ps(&life[i]), vdt);
+
+		_mm_storeu_ps(&x[i], px);
+		_mm_storeu_ps(&y[i], py);
+		_mm_storeu_ps(&yVel[i], _mm_add_ps(vy, vfallDv));
+		_mm_storeu_ps(&life[i], left);
+
+		//Only the lanes that died get written down
+		int deadMask = _mm_movemask_ps(_mm_or_ps(_mm_cmple_ps(left, zero), _mm_cmpgt_ps(py, vbottom)));
+		for (int lane = 0; deadMask != 0; lane++, deadMask >>= 1)
+		{
+			if (deadMask & 1)
+				mDead[mDeadCount++] = (uint32_t)(i + lane);
+		}
+	}
+#endif
+
+	for (; i < mCount; i++)
+	{
+		x[i] += xVel[i] * dt;
+		y[i] += yVel[i] * dt;
+		yVel[i] += fallDv;
+		life[i] -= dt;
+		if (life[i] <= 0.0f || y[i] > bottom)
+			mDead[mDeadCount++] = (uint32_t)i;
+	}
+
+	//Most steps nothing dies, so the arrays are only touched when something did
+	if (mDeadCount > 0)
+		removeDead();
+}
+
+void ParticlePool::removeDead()
+{
+	//Highest slot first, so every particle above the one being filled is
+	// alive and the last one can be moved down into it
+	for (size_t n = mDeadCount; n > 0; n--)
+	{
+		size_t dead = mDead[n - 1];
+		size_t last = --mCount;
+		if (dead == last)
+			continue;
+		x[dead] = x[last];
+		y[dead] = y[last];
+		xVel[dead] = xVel[last];
+		yVel[dead] = yVel[last];
+		life[dead] = life[last];
+		maxLife[dead] = maxLife[last];
+		color[dead] = color[last];
+	}
+	mDeadCount = 0;
+}
+
+size_t ParticlePool::size() const
+{
+	return mCount;
+}
+
+size_t ParticlePool::capacity() const
+{
+	return mCapacity;
+}
+
+uint64_t ParticlePool::getDropped() const
+{
+	return mDropped;
+}
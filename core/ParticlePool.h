@@ -0,0 +1,75 @@
+/*
+PROGRAM: Brick Breakers Using SDL
+PART: Debris particles. A fixed number of slots allocated once, one array
+      per field, moved four at a time. When every slot is taken new
+      particles are dropped, so the cost of a frame has a hard ceiling.
+      Particles are only for show, the rules never see them.
+*/
+#ifndef BRICK_PARTICLEPOOL_H
+#define BRICK_PARTICLEPOOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include "Random.h"
+
+struct Rect;
+
+class ParticlePool
+{
+public:
+	//Slots a pool gets unless it asks for another number
+	static const size_t DEFAULT_CAPACITY = 65536;
+
+	//Pull downwards, in pixels per second squared
+	static constexpr float GRAVITY = 900.0f;
+
+	//Every slot is allocated here, nothing is allocated afterwards
+	explicit ParticlePool(size_t capacity = DEFAULT_CAPACITY);
+
+	//Removes every particle
+	void clear();
+
+	//Adds a particle that lives for life seconds, false if the pool is full
+	bool spawn(float posX, float posY, float velX, float velY, float life, unsigned char color);
+
+	//Scatters count particles out of a rectangle, flying up and outwards.
+	// Returns how many fit.
+	int spawnBurst(const Rect& area, int count, unsigned char color, Random& random);
+
+	//Moves every particle dt seconds and drops the ones that ran out of
+	// life or fell off the bottom of the screen
+	void update(float dt);
+
+	size_t size() const;
+	size_t capacity() const;
+
+	//Particles that didn't fit since the pool was made
+	uint64_t getDropped() const;
+
+	//The live particles are the first size() entries of each, in no
+	// particular order
+	std::vector<float> x, y;
+	std::vector<float> xVel, yVel;
+
+	//Seconds left to live, and how long that was at the start
+	std::vector<float> life, maxLife;
+
+	std::vector<unsigned char> color;
+
+private:
+	//Takes out the particles update() found dead by moving the last live
+	// ones into their slots, so the cost goes with how many died
+	void removeDead();
+
+	size_t mCount;
+	size_t mCapacity;
+	uint64_t mDropped;
+
+	//Slots found dead by the last update, lowest first
+	std::vector<uint32_t> mDead;
+	size_t mDeadCount;
+};
+
+#endif
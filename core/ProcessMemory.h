@@ -0,0 +1,14 @@
+/*
+PROGRAM: Brick Breakers Using SDL
+PART: How much memory the process has resident, for memory reports.
+*/
+#ifndef BRICK_PROCESSMEMORY_H
+#define BRICK_PROCESSMEMORY_H
+
+#include <stddef.h>
+
+//Bytes of the process currently in physical memory, 0 if the platform
+// can't tell
+size_t getResidentBytes();
+
+#endif
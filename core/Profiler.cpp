@@ -0,0 +1,120 @@
+#include "Profiler.h"
+
+#ifdef BRICK_PROFILE
+
+#include <algorithm>
+
+Profiler& Profiler::get()
+{
+	static thread_local Profiler profiler;
+	return profiler;
+}
+
+Profiler::Profiler()
+{
+	for (int i = 0; i < PROFILE_PHASE_COUNT; i++)
+	{
+		mCurrent[i] = 0.0;
+		for (int f = 0; f < HISTORY; f++)
+			mHistory[i][f] = 0.0;
+	}
+	mFrames = 0;
+	mFrameStart = std::chrono::steady_clock::now();
+	mCsv = NULL;
+}
+
+Profiler::~Profiler()
+{
+	closeCsv();
+}
+
+void Profiler::add(int phase, double milliseconds)
+{
+	mCurrent[phase] += milliseconds;
+}
+
+void Profiler::endFrame()
+{
+	//The whole frame is the time since the last one ended
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	mCurrent[PROFILE_FRAME] = std::chrono::duration<double, std::milli>(now - mFrameStart).count();
+	mFrameStart = now;
+
+	if (mCsv != NULL)
+	{
+		fprintf(mCsv, "%u", mFrames);
+		for (int i = 0; i < PROFILE_PHASE_COUNT; i++)
+			fprintf(mCsv, ",%.4f", mCurrent[i]);
+		fprintf(mCsv, "\n");
+	}
+
+	for (int i = 0; i < PROFILE_PHASE_COUNT; i++)
+	{
+		mHistory[i][mFrames % HISTORY] = mCurrent[i];
+		mCurrent[i] = 0.0;
+	}
+	mFrames++;
+}
+
+bool Profiler::openCsv(const char* path)
+{
+	closeCsv();
+
+	mCsv = fopen(path, "w");
+	if (mCsv == NULL)
+	{
+		printf("Unable to create %s!\n", path);
+		return false;
+	}
+
+	fprintf(mCsv, "frame");
+	for (int i = 0; i < PROFILE_PHASE_COUNT; i++)
+		fprintf(mCsv, ",%s_ms", getPhaseName(i));
+	fprintf(mCsv, "\n");
+	return true;
+}
+
+void Profiler::closeCsv()
+{
+	if (mCsv != NULL)
+	{
+		fclose(mCsv);
+		mCsv = NULL;
+	}
+}
+
+Profiler::Stats Profiler::getStats(int phase) const
+{
+	Stats stats = { 0.0, 0.0, 0.0 };
+	int count = mFrames < (unsigned int)HISTORY ? (int)mFrames : HISTORY;
+	if (count == 0)
+		return stats;
+
+	double sorted[HISTORY];
+	std::copy(mHistory[phase], mHistory[phase] + count, sorted);
+	std::sort(sorted, sorted + count);
+
+	double total = 0.0;
+	for (int i = 0; i < count; i++)
+		total += sorted[i];
+
+	stats.min = sorted[0];
+	stats.avg = total / count;
+	stats.p99 = sorted[(count * 99 - 1) / 100];
+	return stats;
+}
+
+unsigned int Profiler::getFrameCount() const
+{
+	return mFrames;
+}
+
+const char* Profiler::getPhaseName(int phase)
+{
+	static const char* names[PROFILE_PHASE_COUNT] = {
+		"events", "step", "balls_fast", "balls_exact", "sound", "draw", "text", "present", "frame"
+	};
+	return names[phase];
+}
+
+#endif
@@ -0,0 +1,117 @@
+/*
+PROGRAM: Brick Breakers Using SDL
+PART: Frame profiler. Scoped timers add up how long each phase of a
+      frame takes, keep a rolling window of frames for min/avg/p99, and
+      can write every frame out to a CSV file. Everything here only
+      exists when BRICK_PROFILE is defined, otherwise PROFILE_SCOPE
+      compiles to nothing.
+*/
+#ifndef BRICK_PROFILER_H
+#define BRICK_PROFILER_H
+
+//The parts of a frame that get timed. Phases can be inside others, the
+// ball passes are part of the step.
+enum ProfilePhase
+{
+	PROFILE_EVENTS,
+	PROFILE_STEP,
+	PROFILE_BALLS_FAST,
+	PROFILE_BALLS_EXACT,
+	PROFILE_SOUND,
+	PROFILE_DRAW,
+	PROFILE_TEXT,
+	PROFILE_PRESENT,
+	PROFILE_FRAME,
+	PROFILE_PHASE_COUNT
+};
+
+#ifdef BRICK_PROFILE
+
+#include <stdio.h>
+#include <chrono>
+
+class Profiler
+{
+public:
+	//Frames the rolling numbers are taken over
+	static const int HISTORY = 240;
+
+	//Milliseconds a phase took over the frames in the window
+	struct Stats
+	{
+		double min;
+		double avg;
+		double p99;
+	};
+
+	//The profiler of the calling thread, games stepped on other threads
+	// keep their own times
+	static Profiler& get();
+
+	//Adds time spent in a phase during the current frame
+	void add(int phase, double milliseconds);
+
+	//Closes the current frame: files its times in the window and the CSV
+	void endFrame();
+
+	//Starts writing one line per frame to a CSV file
+	bool openCsv(const char* path);
+	void closeCsv();
+
+	//Numbers for a phase over the window
+	Stats getStats(int phase) const;
+
+	//Frames closed so far
+	unsigned int getFrameCount() const;
+
+	static const char* getPhaseName(int phase);
+
+private:
+	Profiler();
+	~Profiler();
+
+	//Time spent in each phase during the current frame
+	double mCurrent[PROFILE_PHASE_COUNT];
+
+	//The last HISTORY frames, oldest overwritten first
+	double mHistory[PROFILE_PHASE_COUNT][HISTORY];
+	unsigned int mFrames;
+
+	std::chrono::steady_clock::time_point mFrameStart;
+
+	FILE* mCsv;
+};
+
+//Times from its construction to the end of its scope
+class ProfileScope
+{
+public:
+	explicit ProfileScope(int phase)
+		: mPhase(phase), mStart(std::chrono::steady_clock::now())
+	{
+	}
+
+	~ProfileScope()
+	{
+		std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - mStart;
+		Profiler::get().add(mPhase, elapsed.count());
+	}
+
+private:
+	int mPhase;
+	std::chrono::steady_clock::time_point mStart;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+//Times the rest of the enclosing scope as the given phase
+#define PROFILE_SCOPE(phase) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(phase)
+
+#else
+
+#define PROFILE_SCOPE(phase) ((void)0)
+
+#endif
+
+#endif
@@ -0,0 +1,43 @@
+/*
+PROGRAM: Brick Breakers Using SDL
+PART: A tiny seeded random number generator, so everything random in the
+      rules comes out the same on every run with the same seed.
+*/
+#ifndef BRICK_RANDOM_H
+#define BRICK_RANDOM_H
+
+#include <stdint.h>
+
+//Xorshift, fast and plenty random for spreading balls and debris around
+struct Random
+{
+	explicit Random(uint32_t seed = 1)
+	{
+		//Zero would get stuck at zero forever
+		state = seed != 0 ? seed : 0x9E3779B9u;
+	}
+
+	uint32_t next()
+	{
+		state ^= state << 13;
+		state ^= state >> 17;
+		state ^= state << 5;
+		return state;
+	}
+
+	//A number from 0 up to but not including 1
+	float nextFloat()
+	{
+		return (next() >> 8) * (1.0f / 16777216.0f);
+	}
+
+	//A number from low up to but not including high
+	float range(float low, float high)
+	{
+		return low + (high - low) * nextFloat();
+	}
+
+	uint32_t state;
+};
+
+#endif
@@ -0,0 +1,197 @@
+#include "Replay.h"
+
+#include <stdio.h>
+#include <string.h>
+
+//What byteOrder reads as on a machine with the same byte order as the writer
+static const uint32_t REPLAY_BYTE_ORDER = 0x01020304;
+
+//Longest level path a replay keeps
+static const size_t REPLAY_LEVEL_LENGTH = 128;
+
+//Start of a replay file, followed by runCount runs of a 4 byte step count
+// and a key byte each
+struct ReplayHeader
+{
+	//Always "BRKR"
+	char magic[4];
+	uint32_t byteOrder;
+	uint32_t version;
+
+	int32_t tickRate;
+	int32_t ballCount;
+	uint32_t seed;
+	uint32_t floorBounces;
+
+	uint32_t runCount;
+	uint32_t stepCount;
+	uint32_t unused;
+	uint64_t layoutHash;
+	uint64_t finalHash;
+
+	char level[REPLAY_LEVEL_LENGTH];
+};
+
+static_assert(sizeof(ReplayHeader) == 56 + REPLAY_LEVEL_LENGTH, "ReplayHeader must not have padding");
+
+void Replay::begin(const GameConfig& config, const std::string& levelPath)
+{
+	tickRate = config.tickRate;
+	ballCount = config.ballCount;
+	seed = config.seed;
+	floorBounces = config.floorBounces;
+	level = levelPath;
+	layoutHash = hashLayout(config.layout != NULL ? *config.layout : classicLayout());
+	runs.clear();
+	stepCount = 0;
+	finalHash = 0;
+}
+
+void Replay::record(const Input& input)
+{
+	if (!runs.empty() && runs.back().keys == input.keys && runs.back().steps < UINT32_MAX)
+		runs.back().steps++;
+	else
+	{
+		ReplayRun run = { 1, input.keys };
+		runs.push_back(run);
+	}
+	stepCount++;
+}
+
+void Replay::finish(const GameState& state)
+{
+	finalHash = hashState(state);
+}
+
+void Replay::applyTo(GameConfig& config) const
+{
+	config.tickRate = tickRate;
+	config.ballCount = ballCount;
+	config.seed = seed;
+	config.floorBounces = floorBounces;
+}
+
+bool Replay::save(const char* path) const
+{
+	if (level.size() >= REPLAY_LEVEL_LENGTH)
+	{
+		printf("Unable to save %s, the level path is longer than %zu characters\n", path, REPLAY_LEVEL_LENGTH - 1);
+		return false;
+	}
+
+	ReplayHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, "BRKR", 4);
+	header.byteOrder = REPLAY_BYTE_ORDER;
+	header.version = REPLAY_VERSION;
+	header.tickRate = tickRate;
+	header.ballCount = ballCount;
+	header.seed = seed;
+	header.floorBounces = floorBounces ? 1 : 0;
+	header.runCount = (uint32_t)runs.size();
+	header.stepCount = stepCount;
+	header.layoutHash = layoutHash;
+	header.finalHash = finalHash;
+	memcpy(header.level, level.c_str(), level.size());
+
+	FILE* file = fopen(path, "wb");
+	if (file == NULL)
+	{
+		printf("Unable to create %s!\n", path);
+		return false;
+	}
+
+	fwrite(&header, sizeof(header), 1, file);
+	for (size_t i = 0; i < runs.size(); i++)
+	{
+		fwrite(&runs[i].steps, sizeof(runs[i].steps), 1, file);
+		fwrite(&runs[i].keys, 1, 1, file);
+	}
+
+	bool success = !ferror(file);
+	if (fclose(file) != 0 || !success)
+	{
+		printf("Unable to write %s!\n", path);
+		return false;
+	}
+	return true;
+}
+
+bool Replay::load(const char* path)
+{
+	FILE* file = fopen(path, "rb");
+	if (file == NULL)
+	{
+		printf("Unable to open %s!\n", path);
+		return false;
+	}
+
+	ReplayHeader header;
+	bool success = fread(&header, sizeof(header), 1, file) == 1
+		&& memcmp(header.magic, "BRKR", 4) == 0 && header.byteOrder == REPLAY_BYTE_ORDER
+		&& header.version == REPLAY_VERSION && memchr(header.level, '\0', sizeof(header.level)) != NULL;
+	if (!success)
+		printf("%s is not a replay this build can read\n", path);
+
+	//The runs have to add up to the steps the header claims
+	uint64_t total = 0;
+	runs.clear();
+	for (uint32_t i = 0; success && i < header.runCount; i++)
+	{
+		ReplayRun run;
+		success = fread(&run.steps, sizeof(run.steps), 1, file) == 1 && fread(&run.keys, 1, 1, file) == 1 && run.steps > 0;
+		total += run.steps;
+		runs.push_back(run);
+	}
+	fclose(file);
+
+	if (success && total != header.stepCount)
+		success = false;
+	if (!success)
+	{
+		printf("%s is damaged\n", path);
+		runs.clear();
+		return false;
+	}
+
+	tickRate = header.tickRate;
+	ballCount = header.ballCount;
+	seed = header.seed;
+	floorBounces = header.floorBounces != 0;
+	level = header.level;
+	layoutHash = header.layoutHash;
+	stepCount = header.stepCount;
+	finalHash = header.finalHash;
+	return true;
+}
+
+ReplayCursor::ReplayCursor(const Replay& replay)
+{
+	mReplay = &replay;
+	mRun = 0;
+	mStepInRun = 0;
+	mStep = 0;
+}
+
+bool ReplayCursor::next(Input& input)
+{
+	const std::vector<ReplayRun>& runs = mReplay->runs;
+	while (mRun < runs.size() && mStepInRun >= runs[mRun].steps)
+	{
+		mRun++;
+		mStepInRun = 0;
+	}
+	if (mRun >= runs.size())
+		return false;
+
+	input.keys = runs[mRun].keys;
+	mStepInRun++;
+	mStep++;
+	return true;
+}
+
+uint32_t ReplayCursor::getStep() const
+{
+	return mStep;
+}
@@ -0,0 +1,82 @@
+/*
+PROGRAM: Brick Breakers Using SDL
+PART: Input recording and replay. The keys of every step are stored as
+      runs of steps with the same keys, along with how the game was set
+      up and a hash of how it ended, so a game can be played again step
+      for step and checked.
+*/
+#ifndef BRICK_REPLAY_H
+#define BRICK_REPLAY_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "Game.h"
+
+//Version of the replay layout this build reads and writes
+const uint32_t REPLAY_VERSION = 1;
+
+//Steps in a row that had the same keys held
+struct ReplayRun
+{
+	uint32_t steps;
+	unsigned char keys;
+};
+
+//Everything in a replay file
+struct Replay
+{
+	//How the game was set up, the layout itself isn't stored
+	int tickRate = DEFAULT_TICK_RATE;
+	int ballCount = 1;
+	uint32_t seed = 1;
+	bool floorBounces = false;
+
+	//The level file that was played, empty for the classic level, and a
+	// hash of its bricks to make sure the same level gets used again
+	std::string level;
+	uint64_t layoutHash = 0;
+
+	std::vector<ReplayRun> runs;
+
+	//Steps recorded and the hash of the state after the last one
+	uint32_t stepCount = 0;
+	uint64_t finalHash = 0;
+
+	//Clears the runs and takes the set up from a config
+	void begin(const GameConfig& config, const std::string& levelPath);
+
+	//Adds the keys of one step
+	void record(const Input& input);
+
+	//Notes how the game ended, call it after the last recorded step
+	void finish(const GameState& state);
+
+	//Fills a config with the set up, the layout is left to the caller
+	void applyTo(GameConfig& config) const;
+
+	bool save(const char* path) const;
+	bool load(const char* path);
+};
+
+//Hands out the recorded keys one step at a time
+class ReplayCursor
+{
+public:
+	explicit ReplayCursor(const Replay& replay);
+
+	//Gets the keys of the next step, false once every step has been played
+	bool next(Input& input);
+
+	//Steps handed out so far
+	uint32_t getStep() const;
+
+private:
+	const Replay* mReplay;
+	size_t mRun;
+	uint32_t mStepInRun;
+	uint32_t mStep;
+};
+
+#endif
@@ -0,0 +1,500 @@
+#include "Rewind.h"
+
+#include <string.h>
+#include <chrono>
+#include <type_traits>
+
+//The fixed part of a packed state, followed by the balls' columns, their
+// owners, the bricks' health and the standing bits
+struct RewindHeader
+{
+	int32_t mode;
+	uint32_t tick;
+	int32_t score;
+	int32_t score2;
+	int32_t players;
+	int32_t aliveCount;
+	uint32_t ballCount;
+	uint32_t brickCount;
+	uint32_t prevKeys;
+	Paddle paddle;
+	Paddle paddle2;
+};
+
+static_assert(std::is_trivially_copyable<Paddle>::value, "Paddles are packed as they are");
+
+//The float columns of a ball set, in the order they are packed
+static const int BALL_COLUMNS = 6;
+
+static std::vector<float>& ballColumn(BallSet& balls, int column)
+{
+	std::vector<float>* columns[BALL_COLUMNS] = { &balls.x, &balls.y, &balls.prevX, &balls.prevY, &balls.xVel, &balls.yVel };
+	return *columns[column];
+}
+
+static const std::vector<float>& ballColumn(const BallSet& balls, int column)
+{
+	const std::vector<float>* columns[BALL_COLUMNS] = { &balls.x, &balls.y, &balls.prevX, &balls.prevY, &balls.xVel, &balls.yVel };
+	return *columns[column];
+}
+
+//Every float's first byte, then every float's second byte and so on.
+// Balls move a little every step, so their high bytes rarely change.
+static void writePlanes(const float* values, size_t count, unsigned char* out)
+{
+	for (size_t i = 0; i < count; i++)
+	{
+		uint32_t bits;
+		memcpy(&bits, &values[i], sizeof(bits));
+		out[i] = (unsigned char)bits;
+		out[count + i] = (unsigned char)(bits >> 8);
+		out[2 * count + i] = (unsigned char)(bits >> 16);
+		out[3 * count + i] = (unsigned char)(bits >> 24);
+	}
+}
+
+static void readPlanes(const unsigned char* data, size_t count, float* values)
+{
+	for (size_t i = 0; i < count; i++)
+	{
+		uint32_t bits = (uint32_t)data[i] | ((uint32_t)data[count + i] << 8) | ((uint32_t)data[2 * count + i] << 16) | ((uint32_t)data[3 * count + i] << 24);
+		memcpy(&values[i], &bits, sizeof(bits));
+	}
+}
+
+//Bytes a state with these counts packs into
+static size_t packedSize(size_t balls, size_t bricks)
+{
+	return sizeof(RewindHeader) + balls * (BALL_COLUMNS * sizeof(float) + 1) + bricks + (bricks + 63) / 64 * sizeof(uint64_t);
+}
+
+void packSnapshot(const GameSnapshot& snapshot, std::vector<unsigned char>& out)
+{
+	const GameState& state = snapshot.state;
+	const BallSet& balls = state.balls;
+	size_t ballCount = balls.size();
+	size_t brickCount = state.bricks.size();
+	out.resize(packedSize(ballCount, brickCount));
+
+	//The padding has to be the same every time or it shows up in the deltas
+	RewindHeader header;
+	memset(&header, 0, sizeof(header));
+	header.mode = (int32_t)state.mode;
+	header.tick = state.tick;
+	header.score = state.score;
+	header.score2 = state.score2;
+	header.players = state.players;
+	header.aliveCount = state.bricks.getAliveCount();
+	header.ballCount = (uint32_t)ballCount;
+	header.brickCount = (uint32_t)brickCount;
+	header.prevKeys = snapshot.prevKeys;
+	header.paddle = state.paddle;
+	header.paddle2 = state.paddle2;
+
+	unsigned char* write = &out[0];
+	memcpy(write, &header, sizeof(header));
+	write += sizeof(header);
+
+	if (ballCount > 0)
+	{
+		for (int column = 0; column < BALL_COLUMNS; column++)
+		{
+			writePlanes(&ballColumn(balls, column)[0], ballCount, write);
+			write += ballCount * sizeof(float);
+		}
+		memcpy(write, &balls.owner[0], ballCount);
+		write += ballCount;
+	}
+
+	if (brickCount > 0)
+	{
+		memcpy(write, &state.bricks.getHealths()[0], brickCount);
+		write += brickCount;
+		const std::vector<uint64_t>& alive = state.bricks.getAliveBits();
+		memcpy(write, &alive[0], alive.size() * sizeof(uint64_t));
+	}
+}
+
+bool unpackSnapshot(const unsigned char* data, size_t size, GameSnapshot& snapshot)
+{
+	if (size < sizeof(RewindHeader))
+		return false;
+	RewindHeader header;
+	memcpy(&header, data, sizeof(header));
+
+	//The bricks come from the layout the snapshot already has
+	GameState& state = snapshot.state;
+	if (header.brickCount != state.bricks.size() || size != packedSize(header.ballCount, header.brickCount))
+		return false;
+
+	state.mode = (GAMEMODE)header.mode;
+	state.tick = header.tick;
+	state.score = header.score;
+	state.score2 = header.score2;
+	state.players = header.players;
+	state.paddle = header.paddle;
+	state.paddle2 = header.paddle2;
+	snapshot.prevKeys = (unsigned char)header.prevKeys;
+
+	const unsigned char* read = data + sizeof(header);
+	size_t ballCount = header.ballCount;
+	BallSet& balls = state.balls;
+	for (int column = 0; column < BALL_COLUMNS; column++)
+		ballColumn(balls, column).resize(ballCount);
+	balls.owner.resize(ballCount);
+	if (ballCount > 0)
+	{
+		for (int column = 0; column < BALL_COLUMNS; column++)
+		{
+			readPlanes(read, ballCount, &ballColumn(balls, column)[0]);
+			read += ballCount * sizeof(float);
+		}
+		memcpy(&balls.owner[0], read, ballCount);
+		read += ballCount;
+	}
+
+	state.bricks.restore(read, read + header.brickCount, header.aliveCount);
+	return true;
+}
+
+//A byte of the keyframe, which reads as zero past its end
+static inline unsigned char keyByte(const unsigned char* key, size_t keySize, size_t i)
+{
+	return i < keySize ? key[i] : 0;
+}
+
+static size_t putVarint(unsigned char* out, size_t value)
+{
+	size_t written = 0;
+	while (value >= 0x80)
+	{
+		out[written++] = (unsigned char)(value | 0x80);
+		value >>= 7;
+	}
+	out[written++] = (unsigned char)value;
+	return written;
+}
+
+static size_t getVarint(const unsigned char* data, size_t size, size_t& read)
+{
+	size_t value = 0;
+	int shift = 0;
+	while (read < size)
+	{
+		unsigned char byte = data[read++];
+		value |= (size_t)(byte & 0x7F) << shift;
+		if ((byte & 0x80) == 0)
+			break;
+		shift += 7;
+	}
+	return value;
+}
+
+size_t deltaBound(size_t size)
+{
+	//A run of changed bytes only ends at four unchanged ones, so every
+	// pair of run lengths after the first covers at least five bytes.
+	// Each length takes up to five bytes.
+	return size + (size / 5 + 2) * 10;
+}
+
+size_t encodeDelta(const unsigned char* key, size_t keySize, const unsigned char* data, size_t size, unsigned char* out)
+{
+	size_t common = keySize < size ? keySize : size;
+	size_t written = 0;
+	size_t i = 0;
+	while (i < size)
+	{
+		//Unchanged bytes, eight at a time while there are that many
+		size_t start = i;
+		while (i + 8 <= common)
+		{
+			uint64_t a, b;
+			memcpy(&a, key + i, 8);
+			memcpy(&b, data + i, 8);
+			if (a != b)
+				break;
+			i += 8;
+		}
+		while (i < size && keyByte(key, keySize, i) == data[i])
+			i++;
+		size_t same = i - start;
+
+		//Changed bytes, up to the next four unchanged ones in a row, so a
+		// lone unchanged byte doesn't cost a pair of run lengths
+		size_t changedStart = i;
+		while (i < size)
+		{
+			if (keyByte(key, keySize, i) != data[i])
+			{
+				i++;
+				continue;
+			}
+			size_t run = i;
+			while (run < size && run - i < 4 && keyByte(key, keySize, run) == data[run])
+				run++;
+			if (run - i >= 4 || run == size)
+				break;
+			i = run;
+		}
+
+		written += putVarint(out + written, same);
+		written += putVarint(out + written, i - changedStart);
+		for (size_t j = changedStart; j < i; j++)
+			out[written++] = data[j] ^ keyByte(key, keySize, j);
+	}
+	return written;
+}
+
+void decodeDelta(const unsigned char* key, size_t keySize, const unsigned char* delta, size_t deltaSize, unsigned char* out, size_t size)
+{
+	size_t read = 0;
+	size_t i = 0;
+	while (read < deltaSize && i < size)
+	{
+		size_t same = getVarint(delta, deltaSize, read);
+		size_t changed = getVarint(delta, deltaSize, read);
+		if (same > size - i)
+			same = size - i;
+
+		size_t fromKey = i < keySize ? (keySize - i < same ? keySize - i : same) : 0;
+		memcpy(out + i, key + i, fromKey);
+		memset(out + i + fromKey, 0, same - fromKey);
+		i += same;
+
+		for (size_t j = 0; j < changed && i < size && read < deltaSize; j++, i++)
+			out[i] = delta[read++] ^ keyByte(key, keySize, i);
+	}
+}
+
+RewindBuffer::RewindBuffer(int tickRate, int seconds, size_t budget)
+{
+	mTickRate = tickRate > 0 ? tickRate : DEFAULT_TICK_RATE;
+	mKeyInterval = mTickRate;
+
+	//A whole second more than asked for, the oldest second goes at once
+	if (seconds < 1)
+		seconds = 1;
+	mEntries.resize((size_t)seconds * mTickRate + mKeyInterval + 1);
+	mBytes.resize(budget);
+	mWrite = 0;
+	mUsed = 0;
+	mFirst = 0;
+	mCount = 0;
+}
+
+int RewindBuffer::entryAt(int age) const
+{
+	return (int)((mFirst + age) % mEntries.size());
+}
+
+void RewindBuffer::record(const Game& game)
+{
+	auto start = std::chrono::steady_clock::now();
+	game.save(mSnapshot);
+	packSnapshot(mSnapshot, mRaw);
+
+	//The oldest second ages out once the ring is full
+	if (mCount == (int)mEntries.size())
+		dropOldestGroup();
+
+	//A keyframe once a second, deltas against it in between
+	bool keyframe = true;
+	int key = -1;
+	if (mCount > 0)
+	{
+		int newest = entryAt(mCount - 1);
+		key = mEntries[newest].key;
+		int sinceKey = (int)((newest - key + mEntries.size()) % mEntries.size());
+		keyframe = sinceKey + 1 >= mKeyInterval;
+	}
+
+	const unsigned char* source = &mRaw[0];
+	size_t size = mRaw.size();
+	if (!keyframe)
+	{
+		const Entry& keyEntry = mEntries[key];
+		mDelta.resize(deltaBound(mRaw.size()));
+		size_t deltaSize = encodeDelta(&mBytes[keyEntry.offset], keyEntry.rawSize, &mRaw[0], mRaw.size(), &mDelta[0]);
+
+		//Nothing is gained when most of the state changed
+		if (deltaSize < mRaw.size())
+		{
+			source = &mDelta[0];
+			size = deltaSize;
+		}
+		else
+			keyframe = true;
+	}
+
+	//A delta whose keyframe would have to go to make room is saved whole instead
+	size_t offset = 0;
+	if (!keyframe && !makeRoom(size, key, offset))
+	{
+		keyframe = true;
+		source = &mRaw[0];
+		size = mRaw.size();
+	}
+	if (keyframe && !makeRoom(size, -1, offset))
+	{
+		//Bigger than the whole budget, there is no going back at all
+		mStats.evicted += mCount;
+		clear();
+		return;
+	}
+
+	int index = entryAt(mCount);
+	Entry& entry = mEntries[index];
+	memcpy(&mBytes[offset], source, size);
+	entry.offset = (uint32_t)offset;
+	entry.size = (uint32_t)size;
+	entry.rawSize = (uint32_t)mRaw.size();
+	entry.key = keyframe ? index : key;
+	mCount++;
+	mWrite = offset + size;
+	mUsed += size;
+
+	double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	mStats.recorded++;
+	if (keyframe)
+		mStats.keyframes++;
+	mStats.rawBytes += mRaw.size();
+	mStats.storedBytes += size;
+	mStats.recordMs += ms;
+	if (ms > mStats.maxRecordMs)
+		mStats.maxRecordMs = ms;
+}
+
+bool RewindBuffer::makeRoom(size_t size, int keepKey, size_t& offset)
+{
+	if (size > mBytes.size())
+		return false;
+
+	for (;;)
+	{
+		if (mCount == 0)
+		{
+			mWrite = 0;
+			offset = 0;
+			return true;
+		}
+
+		//The steps either run from the oldest to the newest in one piece,
+		// or from the oldest to the end and round from the start
+		size_t oldest = mEntries[mFirst].offset;
+		size_t newest = mEntries[entryAt(mCount - 1)].offset;
+		if (newest >= oldest)
+		{
+			if (mWrite + size <= mBytes.size())
+			{
+				offset = mWrite;
+				return true;
+			}
+			if (size <= oldest)
+			{
+				offset = 0;
+				return true;
+			}
+		}
+		else if (mWrite + size <= oldest)
+		{
+			offset = mWrite;
+			return true;
+		}
+
+		if (mFirst == keepKey)
+			return false;
+		uint64_t before = mCount;
+		dropOldestGroup();
+		mStats.evicted += before - mCount;
+	}
+}
+
+void RewindBuffer::dropOldestGroup()
+{
+	//The keyframe, then the deltas saved against it
+	do
+	{
+		mUsed -= mEntries[mFirst].size;
+		mFirst = entryAt(1);
+		mCount--;
+	} while (mCount > 0 && mEntries[mFirst].key != mFirst);
+
+	if (mCount == 0)
+	{
+		mFirst = 0;
+		mWrite = 0;
+	}
+}
+
+bool RewindBuffer::rewind(Game& game)
+{
+	if (mCount < 2)
+		return false;
+
+	auto start = std::chrono::steady_clock::now();
+	mUsed -= mEntries[entryAt(mCount - 1)].size;
+	mCount--;
+
+	int newest = entryAt(mCount - 1);
+	mWrite = mEntries[newest].offset + mEntries[newest].size;
+	load(newest, game);
+
+	double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	mStats.rewound++;
+	mStats.rewindMs += ms;
+	if (ms > mStats.maxRewindMs)
+		mStats.maxRewindMs = ms;
+	return true;
+}
+
+void RewindBuffer::load(int index, Game& game)
+{
+	const Entry& entry = mEntries[index];
+	const unsigned char* data = &mBytes[entry.offset];
+	if (entry.key != index)
+	{
+		const Entry& keyEntry = mEntries[entry.key];
+		mRaw.resize(entry.rawSize);
+		decodeDelta(&mBytes[keyEntry.offset], keyEntry.rawSize, data, entry.size, &mRaw[0], entry.rawSize);
+		data = &mRaw[0];
+	}
+
+	//The game's own snapshot has the storage and the layout the bytes go into
+	game.save(mSnapshot);
+	if (unpackSnapshot(data, entry.rawSize, mSnapshot))
+		game.load(mSnapshot);
+}
+
+void RewindBuffer::clear()
+{
+	mFirst = 0;
+	mCount = 0;
+	mWrite = 0;
+	mUsed = 0;
+}
+
+size_t RewindBuffer::getSteps() const
+{
+	return mCount > 0 ? (size_t)mCount - 1 : 0;
+}
+
+double RewindBuffer::getSeconds() const
+{
+	return (double)getSteps() / mTickRate;
+}
+
+size_t RewindBuffer::getBytesUsed() const
+{
+	return mUsed;
+}
+
+size_t RewindBuffer::getBudget() const
+{
+	return mBytes.size();
+}
+
+const RewindStats& RewindBuffer::getStats() const
+{
+	return mStats;
+}
@@ -0,0 +1,143 @@
+/*
+PROGRAM: Brick Breakers Using SDL
+PART: Rewind. Every step the game is saved into a ring of fixed size,
+      most steps as the bytes that changed since the last keyframe and
+      one a second as a keyframe of its own, so going back any number of
+      steps only takes a keyframe and one delta. When the ring runs out
+      of room the oldest second goes, so a level with thousands of bricks
+      and balls keeps to the budget and gets a shorter rewind instead.
+*/
+#ifndef BRICK_REWIND_H
+#define BRICK_REWIND_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include "Game.h"
+
+//How the recording has gone
+struct RewindStats
+{
+	//Steps saved, and how many of them were keyframes
+	uint64_t recorded = 0;
+	uint64_t keyframes = 0;
+
+	//Bytes of the states saved, before and after the deltas
+	uint64_t rawBytes = 0;
+	uint64_t storedBytes = 0;
+
+	//Time spent saving steps
+	double recordMs = 0.0;
+	double maxRecordMs = 0.0;
+
+	//Steps gone back and the time spent putting them back
+	uint64_t rewound = 0;
+	double rewindMs = 0.0;
+	double maxRewindMs = 0.0;
+
+	//Steps dropped to stay in the budget before they were old enough to go
+	uint64_t evicted = 0;
+};
+
+class RewindBuffer
+{
+public:
+	//How far back the game can go, when the budget allows
+	static const int DEFAULT_SECONDS = 30;
+
+	//Bytes the saved steps can take up
+	static const size_t DEFAULT_BUDGET = 8 * 1024 * 1024;
+
+	//Takes the memory for seconds of steps at the tick rate up front,
+	// keyframes come one a second
+	RewindBuffer(int tickRate, int seconds = DEFAULT_SECONDS, size_t budget = DEFAULT_BUDGET);
+
+	//Saves the game as it is after a step
+	void record(const Game& game);
+
+	//Drops the newest step and puts the game back to the one before it,
+	// false if there is nothing further back
+	bool rewind(Game& game);
+
+	//Forgets every step, for a new game
+	void clear();
+
+	//Steps that can be gone back, and the seconds they cover
+	size_t getSteps() const;
+	double getSeconds() const;
+
+	size_t getBytesUsed() const;
+	size_t getBudget() const;
+
+	const RewindStats& getStats() const;
+
+private:
+	//Where a saved step sits in the ring
+	struct Entry
+	{
+		uint32_t offset;
+		uint32_t size;
+
+		//Size of the state once the delta is undone
+		uint32_t rawSize;
+
+		//The entry holding its keyframe, its own index for a keyframe
+		int key;
+	};
+
+	//Index of an entry counted from the oldest
+	int entryAt(int age) const;
+
+	//Somewhere size bytes fit after the newest step, dropping the oldest
+	// seconds to make room. keepKey's second is never dropped, -1 if none
+	// has to stay. Returns false if there is no room.
+	bool makeRoom(size_t size, int keepKey, size_t& offset);
+
+	//Drops the oldest keyframe and every step saved against it
+	void dropOldestGroup();
+
+	//Puts the step an entry holds back into the game
+	void load(int entry, Game& game);
+
+	int mTickRate;
+	int mKeyInterval;
+
+	//The saved steps, one after the other, wrapping round at the end
+	std::vector<unsigned char> mBytes;
+	size_t mWrite;
+	size_t mUsed;
+
+	//Ring of entries, oldest first
+	std::vector<Entry> mEntries;
+	int mFirst;
+	int mCount;
+
+	//Reused every step so saving doesn't allocate once the game is going
+	GameSnapshot mSnapshot;
+	std::vector<unsigned char> mRaw;
+	std::vector<unsigned char> mDelta;
+
+	RewindStats mStats;
+};
+
+//Writes everything in a snapshot out as bytes. The float columns of the
+// balls go byte by byte, so the bytes that hardly change line up.
+void packSnapshot(const GameSnapshot& snapshot, std::vector<unsigned char>& out);
+
+//Reads back what packSnapshot() wrote into a snapshot already holding a
+// state of the same layout, false if the bytes don't fit it
+bool unpackSnapshot(const unsigned char* data, size_t size, GameSnapshot& snapshot);
+
+//Writes the bytes that differ between a state and its keyframe, as runs
+// of unchanged bytes and runs of changed ones. out needs room for
+// deltaBound(size) bytes. Returns the bytes written.
+size_t encodeDelta(const unsigned char* key, size_t keySize, const unsigned char* data, size_t size, unsigned char* out);
+
+//Undoes encodeDelta() into size bytes
+void decodeDelta(const unsigned char* key, size_t keySize, const unsigned char* delta, size_t deltaSize, unsigned char* out, size_t size);
+
+//Most bytes encodeDelta() can write for a state of size bytes
+size_t deltaBound(size_t size);
+
+#endif
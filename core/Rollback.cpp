@@ -0,0 +1,190 @@
+#include "Rollback.h"
+
+#include <chrono>
+
+RollbackSession::RollbackSession(const GameConfig& config, int localPlayer, int inputDelay)
+	: mGame(config)
+{
+	mLocalPlayer = localPlayer == 1 ? 1 : 0;
+	mInputDelay = inputDelay < 0 ? 0 : (inputDelay > MAX_INPUT_DELAY ? MAX_INPUT_DELAY : inputDelay);
+	mFrame = 0;
+	mRemoteConfirmed = 0;
+	mRollbackTo = 0;
+
+	for (int i = 0; i < HISTORY; i++)
+	{
+		mHashes[i] = 0;
+		mRemoteFrames[i] = 0;
+		mRemoteKnown[i] = false;
+	}
+
+	//Snapshots get their storage now rather than during play
+	for (int i = 0; i < HISTORY; i++)
+		mGame.save(mSnapshots[i]);
+}
+
+bool RollbackSession::canAdvance() const
+{
+	return mFrame < mRemoteConfirmed + MAX_ROLLBACK;
+}
+
+bool RollbackSession::advance(const Input& local)
+{
+	if (!canAdvance())
+	{
+		mStats.stalls++;
+		return false;
+	}
+
+	//Play again from the first step that was guessed wrong
+	if (mRollbackTo < mFrame)
+	{
+		auto start = std::chrono::steady_clock::now();
+		int depth = (int)(mFrame - mRollbackTo);
+		mGame.load(mSnapshots[mRollbackTo % HISTORY]);
+		for (uint32_t frame = mRollbackTo; frame < mFrame; frame++)
+			simulate(frame, frame != mRollbackTo);
+
+		double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		mStats.rollbacks++;
+		mStats.resimulatedSteps += depth;
+		mStats.resimulateMs += ms;
+		if (depth > mStats.maxDepth)
+			mStats.maxDepth = depth;
+		if (ms > mStats.maxResimulateMs)
+			mStats.maxResimulateMs = ms;
+	}
+
+	//The keys given now are for a step a little way ahead, the steps
+	// before the first delayed keys are played with none held
+	mLocalInputs[(mFrame + mInputDelay) % HISTORY] = local;
+
+	simulate(mFrame, true);
+	mFrame++;
+	mRollbackTo = mFrame;
+	mStats.steps++;
+	return true;
+}
+
+void RollbackSession::addRemoteInput(uint32_t frame, const Input& input)
+{
+	//Already known, or too far back or ahead to have a slot
+	if (frame < mRemoteConfirmed || frame >= mRemoteConfirmed + HISTORY)
+		return;
+	int slot = frame % HISTORY;
+	if (mRemoteKnown[slot] && mRemoteFrames[slot] == frame)
+		return;
+
+	mRemoteInputs[slot] = input;
+	mRemoteFrames[slot] = frame;
+	mRemoteKnown[slot] = true;
+
+	//A step that was played with a different guess has to be played again
+	if (frame < mFrame && mRemoteUsed[slot].keys != input.keys && frame < mRollbackTo)
+		mRollbackTo = frame;
+
+	while (mRemoteKnown[mRemoteConfirmed % HISTORY] && mRemoteFrames[mRemoteConfirmed % HISTORY] == mRemoteConfirmed)
+		mRemoteConfirmed++;
+
+	//Guesses after the newest known keys were copies of older ones, so
+	// every step after it that was played with something else is wrong too
+	for (uint32_t later = frame + 1; later < mFrame && later < mRollbackTo; later++)
+	{
+		int laterSlot = later % HISTORY;
+		bool known = mRemoteKnown[laterSlot] && mRemoteFrames[laterSlot] == later;
+		if (!known && mRemoteUsed[laterSlot].keys != remoteInputFor(later).keys)
+		{
+			mRollbackTo = later;
+			break;
+		}
+	}
+}
+
+Input RollbackSession::remoteInputFor(uint32_t frame) const
+{
+	//The keys themselves, if they are in
+	int slot = frame % HISTORY;
+	if (mRemoteKnown[slot] && mRemoteFrames[slot] == frame)
+		return mRemoteInputs[slot];
+
+	//Otherwise the remote player is most likely still holding the
+	// newest keys known from before this step
+	for (uint32_t back = frame; back > 0 && frame - back < HISTORY; back--)
+	{
+		int earlier = (back - 1) % HISTORY;
+		if (mRemoteKnown[earlier] && mRemoteFrames[earlier] == back - 1)
+			return mRemoteInputs[earlier];
+	}
+	return Input();
+}
+
+void RollbackSession::simulate(uint32_t frame, bool saveSnapshot)
+{
+	int slot = frame % HISTORY;
+	if (saveSnapshot)
+		mGame.save(mSnapshots[slot]);
+
+	Input local = mLocalInputs[slot];
+	Input remote = remoteInputFor(frame);
+	mRemoteUsed[slot] = remote;
+
+	if (mLocalPlayer == 0)
+		mGame.step(local, remote);
+	else
+		mGame.step(remote, local);
+	mHashes[slot] = hashState(mGame.getState());
+}
+
+uint32_t RollbackSession::getFrame() const
+{
+	return mFrame;
+}
+
+uint32_t RollbackSession::getRemoteConfirmed() const
+{
+	return mRemoteConfirmed;
+}
+
+uint32_t RollbackSession::getLocalKnown() const
+{
+	return mFrame + mInputDelay;
+}
+
+Input RollbackSession::getLocalInput(uint32_t frame) const
+{
+	return mLocalInputs[frame % HISTORY];
+}
+
+bool RollbackSession::getConfirmedHash(uint32_t frame, uint64_t& hash) const
+{
+	//Both players' keys have to be in and played, and the step still kept
+	if (frame >= mRemoteConfirmed || frame >= mRollbackTo || frame + HISTORY <= mFrame)
+		return false;
+	hash = mHashes[frame % HISTORY];
+	return true;
+}
+
+const Game& RollbackSession::getGame() const
+{
+	return mGame;
+}
+
+const RollbackStats& RollbackSession::getStats() const
+{
+	return mStats;
+}
+
+double RollbackSession::timeRollback(int depth)
+{
+	if (depth > (int)mFrame)
+		depth = (int)mFrame;
+	if (depth > HISTORY - 1)
+		depth = HISTORY - 1;
+
+	auto start = std::chrono::steady_clock::now();
+	uint32_t from = mFrame - depth;
+	mGame.load(mSnapshots[from % HISTORY]);
+	for (uint32_t frame = from; frame < mFrame; frame++)
+		simulate(frame, frame != from);
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
@@ -0,0 +1,126 @@
+/*
+PROGRAM: Brick Breakers Using SDL
+PART: Rollback for versus games. Every step goes ahead straight away with
+      the local keys and a guess at the remote ones. When the real remote
+      keys turn out to be different, the game is put back to a snapshot
+      from before that step and played forward again, so the local paddle
+      never waits on the network.
+*/
+#ifndef BRICK_ROLLBACK_H
+#define BRICK_ROLLBACK_H
+
+#include <stdint.h>
+
+#include "Game.h"
+
+//Most steps a late remote input can reach back and change. The session
+// waits for the remote player rather than guess further ahead than this.
+const int MAX_ROLLBACK = 8;
+
+//Most steps the local keys can be held back before they are used
+const int MAX_INPUT_DELAY = 4;
+
+//How the rollbacks have gone
+struct RollbackStats
+{
+	//Steps played the first time round
+	uint64_t steps = 0;
+
+	//Times the game was put back, and the steps played again because of it
+	uint64_t rollbacks = 0;
+	uint64_t resimulatedSteps = 0;
+
+	//Deepest rollback, in steps
+	int maxDepth = 0;
+
+	//Time spent putting games back and playing them forward
+	double resimulateMs = 0.0;
+	double maxResimulateMs = 0.0;
+
+	//Times advance() couldn't go on because the remote keys were too far behind
+	uint64_t stalls = 0;
+};
+
+class RollbackSession
+{
+public:
+	//Steps of snapshots and inputs kept, enough for the deepest rollback
+	// and the input delay
+	static const int HISTORY = 32;
+
+	//localPlayer is 0 or 1, which side of the versus game this end plays.
+	// The local keys are used inputDelay steps after they are given.
+	RollbackSession(const GameConfig& config, int localPlayer, int inputDelay = 0);
+
+	//If the next step can be played without guessing more than
+	// MAX_ROLLBACK steps of remote keys
+	bool canAdvance() const;
+
+	//Plays the next step with the local keys, after playing again any
+	// steps a remote input showed were guessed wrong. Returns false and
+	// does nothing if canAdvance() is false.
+	bool advance(const Input& local);
+
+	//Takes the remote player's keys for a step as they arrive, in any
+	// order. Steps already known or too old to matter are ignored.
+	void addRemoteInput(uint32_t frame, const Input& input);
+
+	//Steps played so far, the next one played is this one
+	uint32_t getFrame() const;
+
+	//Steps the remote keys are known for, from the first one on
+	uint32_t getRemoteConfirmed() const;
+
+	//Steps the local keys are known for, they go out ahead of the game by the input delay
+	uint32_t getLocalKnown() const;
+
+	//The local keys of a step, it has to be one of the last HISTORY known ones
+	Input getLocalInput(uint32_t frame) const;
+
+	//The hash of the state after a step once both players' keys for it
+	// are known, false if that isn't so or the step is too old
+	bool getConfirmedHash(uint32_t frame, uint64_t& hash) const;
+
+	const Game& getGame() const;
+	const RollbackStats& getStats() const;
+
+	//Plays depth steps again from a snapshot, only to time how long a
+	// rollback that deep takes. The game ends up where it was.
+	double timeRollback(int depth);
+
+private:
+	//Saves the snapshot before a step and plays it with the keys known or guessed for it
+	void simulate(uint32_t frame, bool saveSnapshot);
+
+	//The remote keys of a step, or the last ones known if they aren't in yet
+	Input remoteInputFor(uint32_t frame) const;
+
+	Game mGame;
+	int mLocalPlayer;
+	int mInputDelay;
+
+	uint32_t mFrame;
+
+	//Every step before this one has its remote keys in
+	uint32_t mRemoteConfirmed;
+
+	//The first step a wrong guess was found at, mFrame if there isn't one
+	uint32_t mRollbackTo;
+
+	//Per step, indexed by frame % HISTORY
+	GameSnapshot mSnapshots[HISTORY];
+	uint64_t mHashes[HISTORY];
+	Input mLocalInputs[HISTORY];
+	Input mRemoteInputs[HISTORY];
+
+	//Which frame each remote slot holds, so inputs can arrive out of order
+	uint32_t mRemoteFrames[HISTORY];
+	bool mRemoteKnown[HISTORY];
+
+	//The remote keys each step was last played with
+	Input mRemoteUsed[HISTORY];
+
+	RollbackStats mStats;
+};
+
+#endif
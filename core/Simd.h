@@ -0,0 +1,20 @@
+/*
+PROGRAM: Brick Breakers Using SDL
+PART: Which vector instructions the build can use. SSE2 comes with every
+      x86-64 compiler, AVX2 is compiled in per function and only run
+      after checking the CPU.
+*/
+#ifndef BRICK_SIMD_H
+#define BRICK_SIMD_H
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BRICK_HAVE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define BRICK_HAVE_AVX2 1
+#include <immintrin.h>
+#endif
+
+#endif
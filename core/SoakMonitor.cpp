@@ -0,0 +1,109 @@
+#include "SoakMonitor.h"
+#include "ProcessMemory.h"
+
+SoakMonitor::SoakMonitor(double reportInterval)
+{
+	mReportInterval = reportInterval > 0.0 ? reportInterval : 10.0;
+	mWindowStart = 0.0;
+	mBaselineFrame = 0.0;
+	mWindows = 0;
+	mResidentStart = 0;
+	mResidentBaseline = 0;
+	mBaselineTime = 0.0;
+	mStart = std::chrono::steady_clock::now();
+}
+
+void SoakMonitor::start()
+{
+	mStart = std::chrono::steady_clock::now();
+	mWindowStart = 0.0;
+	mWindow = Totals();
+	mRun = Totals();
+	mBaselineFrame = 0.0;
+	mWindows = 0;
+	mResidentStart = getResidentBytes();
+	mResidentBaseline = mResidentStart;
+	mBaselineTime = 0.0;
+}
+
+void SoakMonitor::add(Totals& totals, double seconds)
+{
+	totals.frames++;
+	totals.frameSeconds += seconds;
+	if (seconds > totals.frameMax)
+		totals.frameMax = seconds;
+}
+
+void SoakMonitor::addFrame(double seconds)
+{
+	add(mWindow, seconds);
+	add(mRun, seconds);
+}
+
+void SoakMonitor::addGame(bool won)
+{
+	mWindow.games++;
+	mRun.games++;
+	if (won)
+	{
+		mWindow.wins++;
+		mRun.wins++;
+	}
+}
+
+bool SoakMonitor::report(FILE* out)
+{
+	double now = getElapsed();
+	if (now - mWindowStart < mReportInterval)
+		return false;
+
+	//The first window is what the rest get held up against
+	if (mWindows == 0)
+	{
+		mBaselineFrame = mWindow.frames > 0 ? mWindow.frameSeconds / mWindow.frames : 0.0;
+		mResidentBaseline = getResidentBytes();
+		mBaselineTime = now;
+	}
+	mWindows++;
+
+	print(out, "window", mWindow, now - mWindowStart);
+	mWindow = Totals();
+	mWindowStart = now;
+	return true;
+}
+
+void SoakMonitor::finish(FILE* out)
+{
+	print(out, "total", mRun, getElapsed());
+}
+
+double SoakMonitor::getElapsed() const
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - mStart).count();
+}
+
+uint64_t SoakMonitor::getGames() const
+{
+	return mRun.games;
+}
+
+void SoakMonitor::print(FILE* out, const char* kind, const Totals& totals, double seconds)
+{
+	double elapsed = getElapsed();
+	double frameAvg = totals.frames > 0 ? totals.frameSeconds / totals.frames : 0.0;
+	double drift = mBaselineFrame > 0.0 ? (frameAvg / mBaselineFrame - 1.0) * 100.0 : 0.0;
+
+	//Growth since warm up, and the rate it would go on at over an hour
+	size_t resident = getResidentBytes();
+	double growth = ((double)resident - (double)mResidentBaseline) / 1024.0;
+	double grownFor = elapsed - mBaselineTime;
+	double growthPerHour = grownFor > 0.0 ? growth * 3600.0 / grownFor : 0.0;
+
+	fprintf(out, "{\"soak\": \"%s\", \"elapsed_s\": %.1f, \"seconds\": %.3f, \"games\": %llu, \"wins\": %llu, \"games_per_sec\": %.2f, "
+		"\"frames\": %llu, \"frames_per_sec\": %.1f, \"frame_avg_us\": %.3f, \"frame_max_us\": %.3f, \"frame_drift_pct\": %.2f, "
+		"\"resident_start_kb\": %.0f, \"resident_kb\": %.0f, \"resident_growth_kb\": %.0f, \"resident_growth_kb_per_hour\": %.1f}\n",
+		kind, elapsed, seconds, (unsigned long long)totals.games, (unsigned long long)totals.wins, seconds > 0.0 ? totals.games / seconds : 0.0,
+		(unsigned long long)totals.frames, seconds > 0.0 ? totals.frames / seconds : 0.0, frameAvg * 1e6, totals.frameMax * 1e6, drift,
+		mResidentStart / 1024.0, resident / 1024.0, growth, growthPerHour);
+	fflush(out);
+}
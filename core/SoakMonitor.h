@@ -0,0 +1,75 @@
+/*
+PROGRAM: Brick Breakers Using SDL
+PART: Soak test bookkeeping. Counts games and frames over a long run and
+      prints one JSON line per report window, with games per second, how
+      far the frame time drifted from the first window and how much the
+      resident memory grew, so slowdowns and leaks show up over hours.
+*/
+#ifndef BRICK_SOAKMONITOR_H
+#define BRICK_SOAKMONITOR_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <chrono>
+
+class SoakMonitor
+{
+public:
+	//Seconds of wall time each report covers
+	explicit SoakMonitor(double reportInterval = 10.0);
+
+	//Starts the clock and notes the memory the run started with
+	void start();
+
+	//Adds one frame that took the given seconds
+	void addFrame(double seconds);
+
+	//Adds a game that ended, won if the bricks ran out
+	void addGame(bool won);
+
+	//Prints a line for the window that just closed, if one did. Returns
+	// true if it printed.
+	bool report(FILE* out);
+
+	//Prints a line for the whole run
+	void finish(FILE* out);
+
+	//Seconds since start
+	double getElapsed() const;
+
+	uint64_t getGames() const;
+
+private:
+	//What has been counted over some stretch of the run
+	struct Totals
+	{
+		uint64_t frames = 0;
+		uint64_t games = 0;
+		uint64_t wins = 0;
+		double frameSeconds = 0.0;
+		double frameMax = 0.0;
+	};
+
+	void add(Totals& totals, double seconds);
+	void print(FILE* out, const char* kind, const Totals& totals, double seconds);
+
+	std::chrono::steady_clock::time_point mStart;
+	double mReportInterval;
+	double mWindowStart;
+
+	Totals mWindow;
+	Totals mRun;
+
+	//Average frame time of the first window, what later windows are compared to
+	double mBaselineFrame;
+	int mWindows;
+
+	//Resident bytes at the start and at the end of the first window, the
+	// growth is measured from the second so warm up isn't counted as a leak
+	size_t mResidentStart;
+	size_t mResidentBaseline;
+	double mBaselineTime;
+};
+
+#endif
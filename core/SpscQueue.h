@@ -0,0 +1,71 @@
+/*
+PROGRAM: Brick Breakers Using SDL
+PART: A fixed size lock free queue for one producer thread and one
+      consumer thread, so one side never waits on the other.
+*/
+#ifndef BRICK_SPSCQUEUE_H
+#define BRICK_SPSCQUEUE_H
+
+#include <stddef.h>
+#include <atomic>
+
+//CAPACITY has to be a power of two. Only one thread may push and only
+// one thread may pop, they may be the same thread.
+template <typename T, size_t CAPACITY>
+class SpscQueue
+{
+	static_assert(CAPACITY > 0 && (CAPACITY & (CAPACITY - 1)) == 0, "SpscQueue capacity must be a power of two");
+
+public:
+	SpscQueue()
+		: mHead(0), mTail(0)
+	{
+	}
+
+	//Adds an item at the back, false if the queue is full and the item was dropped
+	bool push(const T& item)
+	{
+		size_t tail = mTail.load(std::memory_order_relaxed);
+		if (tail - mHead.load(std::memory_order_acquire) == CAPACITY)
+			return false;
+
+		mItems[tail & (CAPACITY - 1)] = item;
+		mTail.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+	//Takes the item at the front, false if the queue is empty
+	bool pop(T& item)
+	{
+		size_t head = mHead.load(std::memory_order_relaxed);
+		if (head == mTail.load(std::memory_order_acquire))
+			return false;
+
+		item = mItems[head & (CAPACITY - 1)];
+		mHead.store(head + 1, std::memory_order_release);
+		return true;
+	}
+
+	//Items waiting, only exact when neither side is busy
+	size_t size() const
+	{
+		return mTail.load(std::memory_order_acquire) - mHead.load(std::memory_order_acquire);
+	}
+
+	size_t capacity() const
+	{
+		return CAPACITY;
+	}
+
+	//Copying a queue another thread is using can't be done safely
+	SpscQueue(const SpscQueue&) = delete;
+	SpscQueue& operator=(const SpscQueue&) = delete;
+
+private:
+	//Each end on its own cache line, so the two threads don't fight over one
+	alignas(64) std::atomic<size_t> mHead;
+	alignas(64) std::atomic<size_t> mTail;
+	alignas(64) T mItems[CAPACITY];
+};
+
+#endif
@@ -0,0 +1,96 @@
+#include "Sweep.h"
+#include "Game.h"
+
+#include <math.h>
+
+//Entry and exit times of a box along one axis. False if it never overlaps
+// the target on that axis.
+static bool sweepAxis(float pos, float size, float delta, float targetPos, float targetSize, float& entry, float& exit, float& entryDepth)
+{
+	if (delta == 0.0f)
+	{
+		//Not moving on this axis, it either always overlaps or never does
+		if (pos + size <= targetPos || pos >= targetPos + targetSize)
+			return false;
+		entry = -INFINITY;
+		exit = INFINITY;
+		entryDepth = 0.0f;
+		return true;
+	}
+
+	//Distance to travel until the near sides meet and until the far sides part
+	float entryDistance, exitDistance;
+	if (delta > 0.0f)
+	{
+		entryDistance = targetPos - (pos + size);
+		exitDistance = targetPos + targetSize - pos;
+	}
+	else
+	{
+		entryDistance = pos - (targetPos + targetSize);
+		exitDistance = pos + size - targetPos;
+	}
+
+	float speed = fabsf(delta);
+	entry = entryDistance / speed;
+	exit = exitDistance / speed;
+	entryDepth = -entryDistance;
+	return true;
+}
+
+bool sweepBox(float x, float y, float w, float h, float dx, float dy, const Rect& target, SweepHit& hit)
+{
+	//A box that isn't moving can't run into anything
+	if (dx == 0.0f && dy == 0.0f)
+		return false;
+
+	float entryX, exitX, depthX;
+	float entryY, exitY, depthY;
+	if (!sweepAxis(x, w, dx, (float)target.x, (float)target.w, entryX, exitX, depthX))
+		return false;
+	if (!sweepAxis(y, h, dy, (float)target.y, (float)target.h, entryY, exitY, depthY))
+		return false;
+
+	//They touch once both axes overlap and part as soon as either stops
+	float entry = entryX > entryY ? entryX : entryY;
+	float exit = exitX < exitY ? exitX : exitY;
+	if (entry > exit || entry >= 1.0f || exit <= 0.0f)
+		return false;
+
+	//Started inside, only fine if it is barely in
+	float depth = entryX > entryY ? depthX : depthY;
+	if (entry < 0.0f)
+	{
+		if (depth > SWEEP_SKIN)
+			return false;
+		entry = 0.0f;
+	}
+
+	hit.time = entry;
+	if (entryX > entryY)
+	{
+		hit.normalX = dx > 0.0f ? -1 : 1;
+		hit.normalY = 0;
+	}
+	else
+	{
+		hit.normalX = 0;
+		hit.normalY = dy > 0.0f ? -1 : 1;
+	}
+	return true;
+}
+
+Rect sweptBounds(float x, float y, float w, float h, float dx, float dy)
+{
+	float left = dx < 0.0f ? x + dx : x;
+	float top = dy < 0.0f ? y + dy : y;
+	float right = (dx > 0.0f ? x + dx : x) + w;
+	float bottom = (dy > 0.0f ? y + dy : y) + h;
+
+	Rect bounds;
+	bounds.x = (int)floorf(left);
+	bounds.y = (int)floorf(top);
+	bounds.w = (int)ceilf(right) - bounds.x;
+	bounds.h = (int)ceilf(bottom) - bounds.y;
+	return bounds;
+}
@@ -0,0 +1,33 @@
+/*
+PROGRAM: Brick Breakers Using SDL
+PART: Swept box tests. Finds when during a move a box first touches
+      another one, so fast balls and long steps can't skip through things.
+*/
+#ifndef BRICK_SWEEP_H
+#define BRICK_SWEEP_H
+
+struct Rect;
+
+//How far a box may already be inside another and still count as touching
+// it, covers the rounding left over from the last impact
+const float SWEEP_SKIN = 0.01f;
+
+//Where along a move a box touched something
+struct SweepHit
+{
+	//Fraction of the move at the moment of contact, from 0 to 1
+	float time;
+
+	//Which way the surface that was hit faces, one of them is 0
+	int normalX, normalY;
+};
+
+//Moves the box at x, y of size w by h along dx, dy and reports the first
+// time it touches target. False if they don't touch during the move, or
+// if the box starts out properly inside the target.
+bool sweepBox(float x, float y, float w, float h, float dx, float dy, const Rect& target, SweepHit& hit);
+
+//Smallest rectangle covering a box over its whole move
+Rect sweptBounds(float x, float y, float w, float h, float dx, float dy);
+
+#endif
@@ -0,0 +1,182 @@
+#include "UdpLink.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <winsock2.h>
+#include <ws2tcpip.h>
+typedef int socklen_t;
+#define closesocket_ closesocket
+#else
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#define INVALID_SOCKET (-1)
+#define closesocket_ ::close
+#endif
+
+static_assert(sizeof(sockaddr_in) <= 16, "sockaddr_in has to fit the peer address");
+
+UdpLink::UdpLink()
+{
+	mSocket = (intptr_t)INVALID_SOCKET;
+	memset(mPeer, 0, sizeof(mPeer));
+}
+
+UdpLink::~UdpLink()
+{
+	close();
+}
+
+bool UdpLink::open(int localPort, const char* peerHost, int peerPort)
+{
+	close();
+
+#ifdef _WIN32
+	WSADATA wsa;
+	if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0)
+	{
+		printf("Unable to start Winsock!\n");
+		return false;
+	}
+#endif
+
+	sockaddr_in peer;
+	memset(&peer, 0, sizeof(peer));
+	peer.sin_family = AF_INET;
+	peer.sin_port = htons((unsigned short)peerPort);
+	if (inet_pton(AF_INET, peerHost, &peer.sin_addr) != 1)
+	{
+		printf("%s isn't an IPv4 address!\n", peerHost);
+		return false;
+	}
+	memcpy(mPeer, &peer, sizeof(peer));
+
+	auto sock = socket(AF_INET, SOCK_DGRAM, 0);
+	if (sock == INVALID_SOCKET)
+	{
+		printf("Unable to create a UDP socket!\n");
+		return false;
+	}
+
+	sockaddr_in local;
+	memset(&local, 0, sizeof(local));
+	local.sin_family = AF_INET;
+	local.sin_port = htons((unsigned short)localPort);
+	local.sin_addr.s_addr = htonl(INADDR_ANY);
+	if (bind(sock, (const sockaddr*)&local, sizeof(local)) != 0)
+	{
+		printf("Unable to bind UDP port %d!\n", localPort);
+		closesocket_(sock);
+		return false;
+	}
+
+	//Never wait on the socket, the game has frames to draw
+#ifdef _WIN32
+	u_long nonBlocking = 1;
+	ioctlsocket(sock, FIONBIO, &nonBlocking);
+#else
+	fcntl(sock, F_SETFL, fcntl(sock, F_GETFL, 0) | O_NONBLOCK);
+#endif
+
+	mSocket = (intptr_t)sock;
+	return true;
+}
+
+void UdpLink::close()
+{
+	if (mSocket != (intptr_t)INVALID_SOCKET)
+	{
+		closesocket_(mSocket);
+		mSocket = (intptr_t)INVALID_SOCKET;
+#ifdef _WIN32
+		WSACleanup();
+#endif
+	}
+	mPending.clear();
+}
+
+void UdpLink::setImpairment(const LinkImpairment& impairment)
+{
+	mImpairment = impairment;
+	mRandom = Random(impairment.seed);
+}
+
+void UdpLink::send(const void* data, size_t size)
+{
+	if (mSocket == (intptr_t)INVALID_SOCKET || size > MAX_PACKET)
+		return;
+
+	if (mImpairment.loss > 0.0f && mRandom.nextFloat() < mImpairment.loss)
+	{
+		mStats.dropped++;
+		return;
+	}
+
+	Pending pending;
+	if (!mSpare.empty())
+	{
+		pending.data.swap(mSpare.back());
+		mSpare.pop_back();
+	}
+	pending.data.assign((const unsigned char*)data, (const unsigned char*)data + size);
+
+	//Jitter never sends a packet ahead of one queued before it
+	double delay = mImpairment.latencyMs + mRandom.nextFloat() * mImpairment.jitterMs;
+	pending.due = std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double, std::milli>(delay));
+	if (!mPending.empty() && pending.due < mPending.back().due)
+		pending.due = mPending.back().due;
+	mPending.push_back(std::move(pending));
+	flush();
+}
+
+void UdpLink::flush()
+{
+	auto now = std::chrono::steady_clock::now();
+	while (!mPending.empty() && mPending.front().due <= now)
+	{
+		sendNow(mPending.front().data);
+		mSpare.push_back(std::move(mPending.front().data));
+		mPending.pop_front();
+	}
+}
+
+void UdpLink::sendNow(const std::vector<unsigned char>& data)
+{
+	//A peer that isn't listening yet just misses the packet
+	sendto(mSocket, (const char*)&data[0], (int)data.size(), 0, (const sockaddr*)mPeer, sizeof(sockaddr_in));
+	mStats.sent++;
+}
+
+size_t UdpLink::receive(void* buffer, size_t capacity)
+{
+	if (mSocket == (intptr_t)INVALID_SOCKET)
+		return 0;
+
+	const sockaddr_in* peer = (const sockaddr_in*)mPeer;
+	for (;;)
+	{
+		sockaddr_in from;
+		socklen_t fromSize = sizeof(from);
+		auto size = recvfrom(mSocket, (char*)buffer, (int)capacity, 0, (sockaddr*)&from, &fromSize);
+
+		//Nothing waiting, or an error left over from a packet the peer wasn't there for
+		if (size < 0)
+			return 0;
+
+		//Only the peer gets heard
+		if (from.sin_addr.s_addr != peer->sin_addr.s_addr || from.sin_port != peer->sin_port)
+			continue;
+		mStats.received++;
+		return (size_t)size;
+	}
+}
+
+const LinkStats& UdpLink::getStats() const
+{
+	return mStats;
+}
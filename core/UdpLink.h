@@ -0,0 +1,101 @@
+/*
+PROGRAM: Brick Breakers Using SDL
+PART: A non blocking UDP socket tied to one peer, with made up latency,
+      jitter and packet loss on the way out, so versus games can be
+      tried over loopback the way they would play over a bad connection.
+*/
+#ifndef BRICK_UDPLINK_H
+#define BRICK_UDPLINK_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <chrono>
+#include <deque>
+#include <vector>
+
+#include "Random.h"
+
+//What gets done to the packets on their way out
+struct LinkImpairment
+{
+	//Milliseconds every packet is held back, plus up to jitter more
+	double latencyMs = 0.0;
+	double jitterMs = 0.0;
+
+	//Share of the packets that never get sent, from 0 to 1
+	float loss = 0.0f;
+
+	unsigned int seed = 1;
+};
+
+//Packets handled by a link
+struct LinkStats
+{
+	uint64_t sent = 0;
+	uint64_t dropped = 0;
+	uint64_t received = 0;
+};
+
+class UdpLink
+{
+public:
+	//Biggest packet a link sends or takes
+	static const size_t MAX_PACKET = 1024;
+
+	//Initializes variables
+	UdpLink();
+
+	//Closes the socket
+	~UdpLink();
+
+	//Binds localPort on every interface and sends to peerHost:peerPort,
+	// false if the socket can't be set up or the host isn't an IPv4 address
+	bool open(int localPort, const char* peerHost, int peerPort);
+
+	void close();
+
+	void setImpairment(const LinkImpairment& impairment);
+
+	//Queues a packet, it goes out once its made up latency has passed
+	void send(const void* data, size_t size);
+
+	//Sends the queued packets that are due, call it often
+	void flush();
+
+	//Takes the next packet that came from the peer, 0 if there is none
+	size_t receive(void* buffer, size_t capacity);
+
+	const LinkStats& getStats() const;
+
+	//Copying would close the socket twice
+	UdpLink(const UdpLink&) = delete;
+	UdpLink& operator=(const UdpLink&) = delete;
+
+private:
+	//A packet waiting out its latency
+	struct Pending
+	{
+		std::chrono::steady_clock::time_point due;
+		std::vector<unsigned char> data;
+	};
+
+	//Puts a packet on the wire
+	void sendNow(const std::vector<unsigned char>& data);
+
+	//The socket, a SOCKET on Windows
+	intptr_t mSocket;
+
+	//The peer's address, a sockaddr_in
+	unsigned char mPeer[16];
+
+	LinkImpairment mImpairment;
+	Random mRandom;
+	std::deque<Pending> mPending;
+
+	//Buffers of packets that went out, reused by the next ones
+	std::vector<std::vector<unsigned char> > mSpare;
+
+	LinkStats mStats;
+};
+
+#endif
@@ -0,0 +1,159 @@
+#include "VersusPeer.h"
+
+#include <stddef.h>
+#include <string.h>
+
+static_assert(sizeof(VersusPacket) == 32 + VERSUS_MAX_KEYS, "VersusPacket must not have padding");
+static_assert(VERSUS_MAX_KEYS >= RollbackSession::HISTORY, "A packet has to hold every local input kept");
+
+//The bytes before the keys
+static const size_t VERSUS_HEADER_SIZE = offsetof(VersusPacket, keys);
+
+VersusPeer::VersusPeer(const GameConfig& config, int localPlayer, int inputDelay)
+	: mSession(config, localPlayer, inputDelay)
+{
+	mPeerAck = 0;
+	mRemoteCheckFrame = VERSUS_NO_CHECK;
+	mRemoteCheckHash = 0;
+	mRemoteCheckPending = false;
+}
+
+bool VersusPeer::open(int localPort, const char* peerHost, int peerPort)
+{
+	return mLink.open(localPort, peerHost, peerPort);
+}
+
+void VersusPeer::setImpairment(const LinkImpairment& impairment)
+{
+	mLink.setImpairment(impairment);
+}
+
+bool VersusPeer::update(const Input& local)
+{
+	receive();
+	bool advanced = mSession.advance(local);
+
+	//Sent even while waiting, the peer may be waiting on the same packet
+	sendInputs();
+	mLink.flush();
+	checkRemoteHash();
+	return advanced;
+}
+
+void VersusPeer::receive()
+{
+	VersusPacket packet;
+	size_t size;
+	while ((size = mLink.receive(&packet, sizeof(packet))) != 0)
+	{
+		if (size < VERSUS_HEADER_SIZE || memcmp(packet.magic, "BRKV", 4) != 0 || packet.version != VERSUS_VERSION
+			|| packet.count > VERSUS_MAX_KEYS || size != VERSUS_HEADER_SIZE + packet.count)
+		{
+			mStats.badPackets++;
+			continue;
+		}
+
+		if (packet.ack > mPeerAck)
+			mPeerAck = packet.ack;
+
+		for (uint32_t i = 0; i < packet.count; i++)
+		{
+			Input input;
+			input.keys = packet.keys[i];
+			mSession.addRemoteInput(packet.firstFrame + i, input);
+		}
+
+		//Packets can come in out of order, and the same step is sent until
+		// a newer one is agreed on. Only newer checks are kept.
+		if (packet.checkFrame != VERSUS_NO_CHECK && (mRemoteCheckFrame == VERSUS_NO_CHECK || packet.checkFrame > mRemoteCheckFrame))
+		{
+			mRemoteCheckFrame = packet.checkFrame;
+			mRemoteCheckHash = packet.checkHash;
+			mRemoteCheckPending = true;
+		}
+	}
+}
+
+void VersusPeer::sendInputs()
+{
+	//Every local input the peer hasn't acknowledged, as far back as they are kept
+	uint32_t known = mSession.getLocalKnown();
+	uint32_t first = mPeerAck;
+	if (known > (uint32_t)RollbackSession::HISTORY && first < known - RollbackSession::HISTORY)
+		first = known - RollbackSession::HISTORY;
+	if (first > known)
+		first = known;
+
+	VersusPacket packet;
+	memcpy(packet.magic, "BRKV", 4);
+	packet.version = VERSUS_VERSION;
+	packet.ack = mSession.getRemoteConfirmed();
+	packet.firstFrame = first;
+	packet.count = known - first;
+	for (uint32_t i = 0; i < packet.count; i++)
+		packet.keys[i] = mSession.getLocalInput(first + i).keys;
+
+	//The newest step both players' keys are in for
+	packet.checkFrame = VERSUS_NO_CHECK;
+	packet.checkHash = 0;
+	uint32_t confirmed = mSession.getRemoteConfirmed();
+	if (confirmed > mSession.getFrame())
+		confirmed = mSession.getFrame();
+	uint64_t hash;
+	if (confirmed > 0 && mSession.getConfirmedHash(confirmed - 1, hash))
+	{
+		packet.checkFrame = confirmed - 1;
+		packet.checkHash = hash;
+	}
+
+	mLink.send(&packet, VERSUS_HEADER_SIZE + packet.count);
+}
+
+void VersusPeer::checkRemoteHash()
+{
+	if (!mRemoteCheckPending)
+		return;
+
+	uint64_t hash;
+	if (!mSession.getConfirmedHash(mRemoteCheckFrame, hash))
+	{
+		//Too old to compare any more, a newer one will come
+		if (mRemoteCheckFrame + RollbackSession::HISTORY <= mSession.getFrame())
+			mRemoteCheckPending = false;
+		return;
+	}
+
+	mStats.hashChecks++;
+	if (hash != mRemoteCheckHash)
+	{
+		mStats.desyncs++;
+		if (mStats.firstDesync == VERSUS_NO_CHECK || mRemoteCheckFrame < mStats.firstDesync)
+			mStats.firstDesync = mRemoteCheckFrame;
+	}
+	mRemoteCheckPending = false;
+}
+
+const RollbackSession& VersusPeer::getSession() const
+{
+	return mSession;
+}
+
+RollbackSession& VersusPeer::getSession()
+{
+	return mSession;
+}
+
+const Game& VersusPeer::getGame() const
+{
+	return mSession.getGame();
+}
+
+const LinkStats& VersusPeer::getLinkStats() const
+{
+	return mLink.getStats();
+}
+
+const VersusStats& VersusPeer::getStats() const
+{
+	return mStats;
+}
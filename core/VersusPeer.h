@@ -0,0 +1,107 @@
+/*
+PROGRAM: Brick Breakers Using SDL
+PART: One end of a versus game over UDP. Every step the local keys go
+      out together with the ones the peer hasn't acknowledged yet, so a
+      lost packet is made up for by the next one, and the remote keys
+      that come in are handed to the rollback session. Both ends also
+      send the hash of a step they agree on to catch desyncs.
+*/
+#ifndef BRICK_VERSUSPEER_H
+#define BRICK_VERSUSPEER_H
+
+#include <stdint.h>
+
+#include "Rollback.h"
+#include "UdpLink.h"
+
+//Version of the packet layout, both ends have to speak the same one
+const uint32_t VERSUS_VERSION = 1;
+
+//Most steps of keys in one packet
+const int VERSUS_MAX_KEYS = 64;
+
+//What goes over the wire, only count of the keys are sent
+struct VersusPacket
+{
+	//Always "BRKV"
+	char magic[4];
+	uint32_t version;
+
+	//Every step before this one has the receiver's keys in at the sender
+	uint32_t ack;
+
+	//The step keys[0] is for
+	uint32_t firstFrame;
+	uint32_t count;
+
+	//A step the sender has both players' keys for and the hash of the
+	// state after it, or checkFrame of VERSUS_NO_CHECK
+	uint32_t checkFrame;
+	uint64_t checkHash;
+
+	unsigned char keys[VERSUS_MAX_KEYS];
+};
+
+const uint32_t VERSUS_NO_CHECK = 0xFFFFFFFFu;
+
+//How the connection has gone
+struct VersusStats
+{
+	//Packets that came in but weren't ours
+	uint64_t badPackets = 0;
+
+	//Hashes compared with the peer's and the ones that came out different
+	uint64_t hashChecks = 0;
+	uint64_t desyncs = 0;
+
+	//The first step the hashes were different after
+	uint32_t firstDesync = VERSUS_NO_CHECK;
+};
+
+class VersusPeer
+{
+public:
+	//localPlayer is 0 or 1, the other end has to play the other one
+	VersusPeer(const GameConfig& config, int localPlayer, int inputDelay = 0);
+
+	//Sets up the socket to the other end
+	bool open(int localPort, const char* peerHost, int peerPort);
+
+	void setImpairment(const LinkImpairment& impairment);
+
+	//Takes what the peer sent, plays the next step with the local keys
+	// if the remote ones aren't too far behind, and sends the local keys.
+	// Returns false if the step had to wait for the peer.
+	bool update(const Input& local);
+
+	const RollbackSession& getSession() const;
+	RollbackSession& getSession();
+	const Game& getGame() const;
+	const LinkStats& getLinkStats() const;
+	const VersusStats& getStats() const;
+
+private:
+	//Reads every packet waiting
+	void receive();
+
+	//Sends the keys the peer doesn't have yet and a hash to check
+	void sendInputs();
+
+	//Compares the peer's hash once this end has played that step
+	void checkRemoteHash();
+
+	RollbackSession mSession;
+	UdpLink mLink;
+
+	//Every step before this one has the local keys in at the peer
+	uint32_t mPeerAck;
+
+	//The newest hash the peer sent, and if it still has to be compared
+	uint32_t mRemoteCheckFrame;
+	uint64_t mRemoteCheckHash;
+	bool mRemoteCheckPending;
+
+	VersusStats mStats;
+};
+
+#endif
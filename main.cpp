@@ -7,6 +7,7 @@ DATE: Start~November 8, 2015 | End~December 24, 2015
 //Including All of the cool stuff
 #include <SDL.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string>
 #include <sstream>
 #include <SDL_ttf.h>
@@ -15,25 +16,100 @@ DATE: Start~November 8, 2015 | End~December 24, 2015
 #include <SDL_image.h>
 #include <cmath>
 #include <iostream>
+#include <vector>
+#include <atomic>
+#include <algorithm>
+
+//The game rules
+#include "core/Game.h"
+#include "core/LevelFile.h"
+#include "core/AssetPack.h"
+#include "core/ProcessMemory.h"
+#include "core/SpscQueue.h"
+#include "core/Profiler.h"
+#include "core/Replay.h"
+#include "core/Autopilot.h"
+#include "core/SoakMonitor.h"
+#include "core/ParticlePool.h"
+#include "core/Hash.h"
+#include "core/VersusPeer.h"
+#include "core/Rewind.h"
 
-//Screen Dimensions
-const int SCREEN_WIDTH = 800;
-const int SCREEN_HEIGHT = 600;
 const int JOYSTICK_DEAD_ZONE = 8000;
 
 //Main loop flag
 bool isRunning = true;
 
-//Game Modes
-enum class GAMEMODE{
-	MENU,
-	EXIT,
-	PLAY,
-	SCORE,
-	WIN
-};
+//How games get set up, changed from the command line
+GameConfig gConfig;
+
+//The level picked on the command line, mapped for as long as the game runs
+LevelFile gLevel;
+
+//Path of that level, kept for replays
+std::string gLevelPath;
+
+//Where the keys of this session get recorded to, NULL if they aren't
+const char* gRecordPath = NULL;
+
+//The replay being played instead of the player's keys, NULL if none
+const char* gReplayPath = NULL;
+
+//The keys being recorded, or the ones being played back
+Replay gReplay;
+ReplayCursor gReplayCursor(gReplay);
+
+//If presenting waits for the display, otherwise frames get paced by hand
+bool gVsync = false;
+
+//Plays the paddle instead of the player when asked for on the command line,
+// NULL otherwise. Its keys go through the same events the keyboard sends.
+Autopilot* gAutopilot = NULL;
+bool gAutoplay = false;
+
+//One step per frame as fast as frames can be drawn, no vsync and no pacing
+bool gUncapped = false;
+
+//Megabytes the rewind can keep, 0 turns it off. Holding Backspace plays
+// the game backwards for as long as that covers, up to 30 seconds.
+int gRewindMb = (int)(RewindBuffer::DEFAULT_BUDGET / (1024 * 1024));
+
+//The other end of a versus game, NULL when playing alone. The game on
+// the screen is the one the rollback session plays, the local keys go
+// to it instead of to a game of our own.
+VersusPeer* gVersus = NULL;
+
+//Games, frame times and memory over an autoplayed session
+SoakMonitor gSoak;
+
+//When the last frame was presented, to time the frames for the soak report
+Uint64 gLastFrameCounter = 0;
+
+//Frames drawn by the software renderer into a surface instead of a
+// window, under the dummy video driver, 0 for a normal game. The game
+// plays itself one step per frame and quits after that many frames.
+int gOffscreenFrames = 0;
+SDL_Surface* gOffscreenSurface = NULL;
+
+//Where the offscreen frames get saved as BMPs, and the files their hashes
+// are written to and compared against. NULL for each that isn't wanted.
+const char* gDumpDir = NULL;
+const char* gHashPath = NULL;
+const char* gGoldenPath = NULL;
+
+//How long each offscreen frame took, and what it looked like
+std::vector<double> gOffscreenTimes;
+std::vector<uint64_t> gOffscreenHashes;
 
-GAMEMODE GameState = GAMEMODE::MENU;
+//When drawing the current offscreen frame started
+Uint64 gOffscreenFrameStart = 0;
+
+//Longest stretch of real time simulated in one frame, so a stall
+// doesn't turn into an endless catch up
+const double MAX_FRAME_TIME = 0.25;
+
+//Longest an idle screen sleeps in the event queue before it checks on the asset loader
+const Uint32 IDLE_WAIT_MS = 250;
 
 //Texture wrapper class
 class LTexture
@@ -48,6 +124,10 @@ public:
 	//Loads image at specified path
 	bool loadFromFile(std::string path);
 
+	//Creates the texture out of an image that was already decoded, the
+	// surface is freed either way
+	bool loadFromSurface(SDL_Surface* loadedSurface);
+
 #ifdef _SDL_TTF_H
 	//Creates image from font string
 	bool loadFromRenderedText(std::string textureText, SDL_Color textColor);
@@ -81,83 +161,214 @@ private:
 	int mHeight;
 };
 
-//The player that will move around on the screen
-class Player
+//Every printable glyph of a font packed into one texture
+class LFontAtlas
 {
 public:
-	//The dimensions of the player
-	static const int PLAYER_WIDTH = 80;
-	static const int PLAYER_HEIGHT = 40;
+	//The range of characters that get packed
+	static const int FIRST_GLYPH = 32;
+	static const int LAST_GLYPH = 126;
 
-	//Maximum axis velocity of the player
-	static const int PLAYER_VEL = 9;
+	//Width of the atlas texture, glyphs wrap onto new rows past this
+	static const int ATLAS_WIDTH = 512;
 
-	int score = 0;
-	std::string textScore = std::to_string(score);
+	//Initializes variables
+	LFontAtlas();
+
+	//Deallocates memory
+	~LFontAtlas();
 
-	unsigned int healthPoints;
-	unsigned int lives;
+	//Rasterizes the glyphs of an opened font into the atlas
+	bool loadFromFont(TTF_Font* font);
 
-	//Initializes the variables
-	Player();
+	//Deallocates the atlas
+	void free();
 
-	//Takes key presses and adjusts the player's velocity
-	void handleEvent(SDL_Event& e);
+	//Gets where a character lives in the atlas and how far it moves the pen
+	SDL_Rect getClip(char c);
+	int getAdvance(char c);
+
+	//Gets the distance between two lines of text
+	int getLineSkip();
+	int getFontHeight();
+
+	//Gets the atlas texture and its dimensions
+	SDL_Texture* getTexture();
+	int getWidth();
+	int getHeight();
+
+private:
+	//Maps a character onto its slot, unknown characters become '?'
+	int glyphIndex(char c);
+
+	//The actual hardware texture
+	SDL_Texture* mTexture;
+
+	//Atlas dimensions
+	int mWidth;
+	int mHeight;
+
+	//Per glyph location and pen advance
+	SDL_Rect mClips[LAST_GLYPH - FIRST_GLYPH + 1];
+	int mAdvances[LAST_GLYPH - FIRST_GLYPH + 1];
+
+	int mLineSkip;
+	int mFontHeight;
+};
+
+//A string drawn out of the font atlas, the glyph quads are only
+// rebuilt when the string changes
+class LText
+{
+public:
+	//Initializes variables
+	LText();
 
-	//Moves the player
-	void move();
+	//Sets the string to draw, does nothing if it did not change
+	void setText(const std::string& text);
 
-	//Shows the player on the screen
-	void render();
+	//Renders the text with its top left corner at the given point
+	void render(int x, int y);
 
-	//The rectangular colliders for the player
-	SDL_Rect pColliderLeft;
-	SDL_Rect pColliderMid;
-	SDL_Rect pColliderRight;
+	//Gets the dimensions of the laid out text
+	int getWidth();
+	int getHeight();
+
+private:
+	//The string the quads were built for
+	std::string mText;
 
-	// FOR NOW private:
-	//The X and Y offsets of the player
+	//Two triangles per glyph, submitted in one call
+	std::vector<SDL_Vertex> mVertices;
+	std::vector<int> mIndices;
+
+	//Where the quads are currently placed
 	int mPosX, mPosY;
 
-	//The velocity of the player
-	int mVelX, mVelY;
+	//Text dimensions
+	int mWidth;
+	int mHeight;
+};
+
+//The standing bricks drawn once into a texture. Destroyed bricks are
+// cut out of it, so a frame only has to copy it to the screen.
+class LBrickLayer
+{
+public:
+	//Initializes variables
+	LBrickLayer();
+
+	//Deallocates memory
+	~LBrickLayer();
+
+	//Creates the target texture, false if the renderer can't draw into textures
+	bool create(int width, int height);
+
+	//Deallocates the texture
+	void free();
+
+	//Asks for the whole layer to be drawn again before the next copy,
+	// after a new level or after the renderer lost the texture contents
+	void invalidate();
+
+	//Cuts a destroyed brick out of the layer
+	void eraseBrick(const BrickGrid& bricks, int brick);
+
+	//Copies the layer to the screen, redrawing it first if it was invalidated
+	void render(const BrickGrid& bricks);
+
+	//If there is a texture to draw into
+	bool isReady();
+
+private:
+	//Draws every standing brick into the texture
+	void rebuild(const BrickGrid& bricks);
+
+	SDL_Texture* mTexture;
+
+	int mWidth;
+	int mHeight;
+
+	//If the texture no longer matches the bricks
+	bool mDirty;
+};
+
+//The sound samples the game plays, each gets its own group of voices
+enum SOUND
+{
+	SOUND_BOUNCE,
+	SOUND_COUNT
 };
 
-class Enemy
+//Most voices one sample may have playing at once
+const int VOICES_PER_SOUND = 4;
+
+//A sound the simulation asked for
+struct SoundEvent
+{
+	unsigned char sound;
+};
+
+//Takes the sounds the simulation queued and plays them. Repeats of a
+// sample within one frame are played once, and a sample that already
+// has all of its voices playing cuts its oldest one off.
+class LSoundDispatcher
 {
 public:
-	//LENGTH and Width of the enemy
-	static const int ENEMY_WIDTH = 50;
-	static const int ENEMY_HEIGHT = 25;
+	//Initializes variables
+	LSoundDispatcher();
+
+	//Gives every sample its own group of mixer channels, call it once audio is open
+	bool init();
+
+	//Sets the chunk played for a sound
+	void setChunk(int sound, Mix_Chunk* chunk);
+
+	//Plays everything queued since the last call
+	void dispatch();
 
-	int healthPoints = 1;
-	bool isAlive = true;
-	//The direction of the enemy
-	bool point = false;
+	//Prints what happened to the sounds asked for
+	void report(int dropped);
 
-	//moving the enemy right
-	void move();
+private:
+	Mix_Chunk* mChunks[SOUND_COUNT];
+
+	//Sounds taken off the queue, actually played, merged into another
+	// of the same frame, and played over a voice that was still busy
+	int mRequested;
+	int mPlayed;
+	int mCoalesced;
+	int mStolen;
+};
+
+//The player: turns key presses into input for the game and draws the paddle
+class Player
+{
+public:
+	int score = 0;
+	int score2 = -1;
+	std::string textScore = std::to_string(score);
 
-	//Render the enemy on the screen, as long
-	// as the enemy is alive-the boolean function
-	bool render(SDL_Rect& playerBullet, Player& playerObj, int& ballXDir, int& ballYDir, SDL_Rect& ballRect);
-	void reset(int posX, int posY);
+	//Initializes the variables
+	Player();
 
-	//Enemy();
+	//Takes key presses and updates the keys held down
+	void handleEvent(SDL_Event& e);
 
-	Enemy(int posX, int posY);
+	//Keeps the score text in step with the game's score
+	void setScore(int newScore);
 
-	int ePosX, ePosY, eVel;
+	//Both scores of a versus game, the first player's first
+	void setScores(int first, int second);
 
-	//The rectangular colliders for the enemy
-	SDL_Rect eRect;
-	SDL_Rect eColliderUp;
-	SDL_Rect eColliderDown;
-	SDL_Rect eColliderRight;
-	SDL_Rect eColliderLeft;
+	//Shows the paddle on the screen, alpha of the way from its last position
+	void render(const Paddle& paddle, float alpha);
 
+	//The keys that are currently held down
+	Input input;
 };
 
+
 //This is the window that will be rendered
 SDL_Window* gWindow = NULL;
 
@@ -170,8 +381,17 @@ SDL_Renderer* gRenderer = NULL;
 //texter of the player
 LTexture gPlayerTexture;
 
-//Rendered texture
-LTexture gTextTexture;
+//Glyphs of the global font
+LFontAtlas gFontAtlas;
+
+//The bricks of the game being played
+LBrickLayer gBrickLayer;
+
+//Text shown on each screen
+LText gScoreText;
+LText gMenuText;
+LText gFinalScoreText;
+LText gWinText;
 
 SDL_Joystick* gGameController = NULL;
 
@@ -181,9 +401,93 @@ Mix_Music *gMusic = NULL;
 //The sound effects that will be used
 Mix_Chunk *gBounce = NULL;
 
+//Sounds asked for by the simulation, waiting for the dispatcher
+SpscQueue<SoundEvent, 1024> gSoundQueue;
+
+//Sounds that didn't fit in the queue, only counted by the simulation side
+int gDroppedSounds = 0;
+
+LSoundDispatcher gSounds;
+
+#ifdef BRICK_PROFILE
+//If the profiler overlay is showing, F3 flips it
+bool gProfileOverlay = false;
+
+//The numbers on the overlay
+LText gProfileText;
+#endif
+
 //Globally used font
 TTF_Font *gFont = NULL;
 
+//Every asset in one mapped file, loose files are used if there is no pack
+const char* ASSET_PACK_PATH = "assets.pack";
+AssetPack gPack;
+
+//The music, compressed and streamed if there is an Ogg Vorbis version of it
+const char* MUSIC_OGG = "Patrick is good at making music.ogg";
+const char* MUSIC_WAV = "Patrick is good at making music.wav";
+
+//Assets decoded on the loader thread. The main thread picks them up once
+// done is set and turns them into textures and sounds.
+struct AssetLoader
+{
+	SDL_Thread* thread = NULL;
+	std::atomic<bool> done{ false };
+	bool success = false;
+
+	SDL_Surface* playerSurface = NULL;
+	Mix_Chunk* bounce = NULL;
+};
+AssetLoader gLoader;
+
+//If the player texture, the music and the sounds are in place
+bool gAssetsReady = false;
+
+//When the program started, to report how long start up takes
+Uint64 gStartCounter = 0;
+
+//If the first frame has been presented yet
+bool gFirstFramePresented = false;
+
+//Draw submissions made to the renderer, to see what batching saves
+struct DrawStats
+{
+	//Calls made during the frame being drawn
+	int calls = 0;
+
+	//Of those, the ones that drew bricks, and how many bricks they covered
+	int brickCalls = 0;
+	int brickRects = 0;
+
+	//Totals since the last report
+	int frames = 0;
+	long long totalCalls = 0;
+	long long totalBrickCalls = 0;
+	long long totalBrickRects = 0;
+	Uint32 lastReport = 0;
+};
+
+//If the draw counts get printed, set from the command line
+bool gDrawStatsEnabled = false;
+
+//Draw every brick with its own call like the game used to, to compare against
+bool gUnbatchedBricks = false;
+
+DrawStats gDrawStats;
+
+//Debris flying off destroyed bricks, only for show
+ParticlePool gParticles;
+
+//Where the debris goes, kept apart from the rules so replays don't notice it
+Random gDebrisRandom(2015);
+
+//Particles thrown out by every destroyed brick, changed from the command line
+int gDebrisPerBrick = 24;
+
+//Size of a particle on the screen
+const int PARTICLE_SIZE = 3;
+
 LTexture::LTexture()
 {
 	//Initialize
@@ -203,33 +507,42 @@ bool LTexture::loadFromFile(std::string path)
 	//Get rid of preexisting texture
 	free();
 
-	//The final texture
-	SDL_Texture* newTexture = NULL;
-
 	//Load image at specified path
 	SDL_Surface* loadedSurface = IMG_Load(path.c_str());
 	if (loadedSurface == NULL)
-		printf("Unable to load image %s! SDL_image Error: %s\n");
-	else
 	{
-		//Color key image
-		SDL_SetColorKey(loadedSurface, SDL_TRUE, SDL_MapRGB(loadedSurface->format, 0, 0xFF, 0xFF));
+		printf("Unable to load image %s! SDL_image Error: %s\n", path.c_str(), IMG_GetError());
+		return false;
+	}
 
-		//Create texture from surface pixels
-		newTexture = SDL_CreateTextureFromSurface(gRenderer, loadedSurface);
-		if (newTexture == NULL)
-			printf("Unable to create texture from %s! SDL Error: %s\n", path.c_str(), SDL_GetError());
-		else
-		{
-			//Get image dimensions
-			mWidth = loadedSurface->w;
-			mHeight = loadedSurface->h;
-		}
+	//Color key image
+	SDL_SetColorKey(loadedSurface, SDL_TRUE, SDL_MapRGB(loadedSurface->format, 0, 0xFF, 0xFF));
+
+	return loadFromSurface(loadedSurface);
+}
+
+bool LTexture::loadFromSurface(SDL_Surface* loadedSurface)
+{
+	//Get rid of preexisting texture
+	free();
+
+	//The final texture
+	SDL_Texture* newTexture = NULL;
 
-		//Get rid of old loaded surface
-		SDL_FreeSurface(loadedSurface);
+	//Create texture from surface pixels
+	newTexture = SDL_CreateTextureFromSurface(gRenderer, loadedSurface);
+	if (newTexture == NULL)
+		printf("Unable to create texture! SDL Error: %s\n", SDL_GetError());
+	else
+	{
+		//Get image dimensions
+		mWidth = loadedSurface->w;
+		mHeight = loadedSurface->h;
 	}
 
+	//Get rid of old loaded surface
+	SDL_FreeSurface(loadedSurface);
+
 	//Return success
 	mTexture = newTexture;
 	return mTexture != NULL;
@@ -311,6 +624,7 @@ void LTexture::render(int x, int y, SDL_Rect* clip, double angle, SDL_Point* cen
 
 	//Render to screen
 	SDL_RenderCopyEx(gRenderer, mTexture, clip, &renderQuad, angle, center, flip);
+	gDrawStats.calls++;
 }
 
 int LTexture::getWidth()
@@ -323,298 +637,728 @@ int LTexture::getHeight()
 	return mHeight;
 }
 
-Player::Player()
+LFontAtlas::LFontAtlas()
 {
-	//Initialize the offsets
-	mPosX = (SCREEN_WIDTH / 2) - (PLAYER_WIDTH / 2);
-	mPosY = SCREEN_HEIGHT - PLAYER_HEIGHT - 20;
+	//Initialize
+	mTexture = NULL;
+	mWidth = 0;
+	mHeight = 0;
+	mLineSkip = 0;
+	mFontHeight = 0;
 
-	//Initialize the velocity
-	mVelX = 0;
-	mVelY = 0;
+	for (int i = 0; i <= LAST_GLYPH - FIRST_GLYPH; i++)
+	{
+		mClips[i] = { 0, 0, 0, 0 };
+		mAdvances[i] = 0;
+	}
+}
 
-	healthPoints = 1;
-	lives = 3;
-	score = 0;
+LFontAtlas::~LFontAtlas()
+{
+	//Deallocate
+	free();
+}
 
-	pColliderLeft.w = 26;
-	pColliderLeft.h = 26;
-	pColliderLeft.x = mPosX;
-	pColliderLeft.y = mPosY;
+bool LFontAtlas::loadFromFont(TTF_Font* font)
+{
+	//Get rid of preexisting atlas
+	free();
 
-	pColliderMid.w = 26;
-	pColliderMid.h = 26;
-	pColliderMid.x = mPosX + 26;
-	pColliderMid.y = mPosY;
+	const int glyphCount = LAST_GLYPH - FIRST_GLYPH + 1;
+	SDL_Color white = { 0xFF, 0xFF, 0xFF, 0xFF };
+	SDL_Surface* glyphs[glyphCount];
 
-	pColliderRight.w = 26;
-	pColliderRight.h = 26;
-	pColliderRight.x = mPosX + 52;
-	pColliderRight.y = mPosY;
+	mLineSkip = TTF_FontLineSkip(font);
+	mFontHeight = TTF_FontHeight(font);
 
-}
+	//Rasterize each glyph and work out where it goes, one row at a time
+	int penX = 0;
+	int penY = 0;
+	int rowHeight = 0;
+	for (int i = 0; i < glyphCount; i++)
+	{
+		Uint16 ch = (Uint16)(FIRST_GLYPH + i);
+		int minX, maxX, minY, maxY, advance;
+		if (TTF_GlyphMetrics(font, ch, &minX, &maxX, &minY, &maxY, &advance) == -1)
+			advance = 0;
+		mAdvances[i] = advance;
+
+		glyphs[i] = TTF_RenderGlyph_Blended(font, ch, white);
+		if (glyphs[i] == NULL)
+		{
+			mClips[i] = { 0, 0, 0, 0 };
+			continue;
+		}
 
-void Player::handleEvent(SDL_Event& e)
-{
-	//If a key was pressed
-	if (e.type == SDL_KEYDOWN && e.key.repeat == 0)
+		if (penX + glyphs[i]->w > ATLAS_WIDTH)
+		{
+			penX = 0;
+			penY += rowHeight + 1;
+			rowHeight = 0;
+		}
+
+		mClips[i] = { penX, penY, glyphs[i]->w, glyphs[i]->h };
+		penX += glyphs[i]->w + 1;
+		if (glyphs[i]->h > rowHeight)
+			rowHeight = glyphs[i]->h;
+	}
+
+	//Copy the glyphs into one surface, keeping their alpha
+	SDL_Surface* atlasSurface = SDL_CreateRGBSurfaceWithFormat(0, ATLAS_WIDTH, penY + rowHeight, 32, SDL_PIXELFORMAT_ARGB8888);
+	if (atlasSurface == NULL)
+		printf("Unable to create glyph atlas surface! SDL Error: %s\n", SDL_GetError());
+
+	for (int i = 0; i < glyphCount; i++)
 	{
-		//Adjust the velocity
-		switch (e.key.keysym.sym)
+		if (glyphs[i] == NULL)
+			continue;
+
+		if (atlasSurface != NULL)
 		{
-		case SDLK_UP: mVelY -= PLAYER_VEL; break;
-		case SDLK_DOWN: mVelY += PLAYER_VEL; break;
-		case SDLK_LEFT: mVelX -= PLAYER_VEL; break;
-		case SDLK_RIGHT: mVelX += PLAYER_VEL; break;
-		case SDLK_SPACE:
-			if (GameState == GAMEMODE::MENU)
-				GameState = GAMEMODE::PLAY;
-			else if (GameState == GAMEMODE::SCORE || GameState == GAMEMODE::WIN)
-				GameState = GAMEMODE::MENU;
-			break;
+			SDL_SetSurfaceBlendMode(glyphs[i], SDL_BLENDMODE_NONE);
+			SDL_BlitSurface(glyphs[i], NULL, atlasSurface, &mClips[i]);
 		}
+		SDL_FreeSurface(glyphs[i]);
 	}
-	//If a key was released
-	else if (e.type == SDL_KEYUP && e.key.repeat == 0)
+
+	if (atlasSurface != NULL)
 	{
-		//Adjust the velocity
-		switch (e.key.keysym.sym)
+		//Create texture from surface pixels
+		mTexture = SDL_CreateTextureFromSurface(gRenderer, atlasSurface);
+		if (mTexture == NULL)
+			printf("Unable to create glyph atlas texture! SDL Error: %s\n", SDL_GetError());
+		else
 		{
-		case SDLK_UP: mVelY += PLAYER_VEL; break;
-		case SDLK_DOWN: mVelY -= PLAYER_VEL; break;
-		case SDLK_LEFT: mVelX += PLAYER_VEL; break;
-		case SDLK_RIGHT: mVelX -= PLAYER_VEL; break;
+			SDL_SetTextureBlendMode(mTexture, SDL_BLENDMODE_BLEND);
+			mWidth = atlasSurface->w;
+			mHeight = atlasSurface->h;
 		}
+
+		//Get rid of the packed surface
+		SDL_FreeSurface(atlasSurface);
 	}
+
+	//Return success
+	return mTexture != NULL;
 }
 
-void Player::move()
+void LFontAtlas::free()
 {
-	pColliderLeft.x = mPosX;
-	pColliderMid.x = mPosX + 26;
-	pColliderRight.x = mPosX + 52;
+	//Free texture if it exists
+	if (mTexture != NULL)
+	{
+		SDL_DestroyTexture(mTexture);
+		mTexture = NULL;
+		mWidth = 0;
+		mHeight = 0;
+	}
+}
 
-	//Move the player left or right
-	mPosX += mVelX;
+int LFontAtlas::glyphIndex(char c)
+{
+	if (c < FIRST_GLYPH || c > LAST_GLYPH)
+		c = '?';
+	return c - FIRST_GLYPH;
+}
 
-	//If the player went too far to the left or right
-	if ((mPosX < 0) || (mPosX + PLAYER_WIDTH > SCREEN_WIDTH))
-		mPosX -= mVelX;//Move back
+SDL_Rect LFontAtlas::getClip(char c)
+{
+	return mClips[glyphIndex(c)];
 }
 
-void Player::render()
+int LFontAtlas::getAdvance(char c)
 {
-	//display the player on the screen
-	gPlayerTexture.render(mPosX, mPosY);
-}
-
-Enemy::Enemy(int posX, int posY)
-{
-	ePosX = posX;
-	ePosY = posY;
-
-	eRect.w = ENEMY_WIDTH;
-	eRect.h = ENEMY_HEIGHT;
-	eRect.x = ePosX;
-	eRect.y = ePosY;
-	eColliderUp.w = ENEMY_WIDTH - 4;
-	eColliderUp.h = ENEMY_HEIGHT / 2;
-	eColliderUp.x = ePosX + 2;
-	eColliderUp.y = ePosY;
-
-	eColliderDown.w = ENEMY_WIDTH - 4;
-	eColliderDown.h = ENEMY_HEIGHT / 2;
-	eColliderDown.x = ePosX + 2;
-	eColliderDown.y = ePosY + ENEMY_HEIGHT / 2;
-
-	eColliderRight.w = ENEMY_WIDTH / 2;
-	eColliderRight.h = ENEMY_HEIGHT - 4;
-	eColliderRight.x = ePosX + ENEMY_WIDTH / 2;
-	eColliderRight.y = ePosY + 2;
-
-	eColliderLeft.w = ENEMY_WIDTH / 2 + 2;
-	eColliderLeft.h = ENEMY_HEIGHT - 4;
-	eColliderLeft.x = ePosX;
-	eColliderLeft.y = ePosY;
-	eVel = 4;
-}
-
-bool checkCollision(SDL_Rect a, SDL_Rect b)
-{
-	//The sides of the rectangles
-	int leftA, leftB;
-	int rightA, rightB;
-	int topA, topB;
-	int bottomA, bottomB;
-
-	//Calculate the sides of rect A
-	leftA = a.x;
-	rightA = a.x + a.w;
-	topA = a.y;
-	bottomA = a.y + a.h;
-
-	//Calculate the sides of rect B
-	leftB = b.x;
-	rightB = b.x + b.w;
-	topB = b.y;
-	bottomB = b.y + b.h;
-
-	//If any of the sides from A are outside of B
-	if (bottomA <= topB)
-		return false;
+	return mAdvances[glyphIndex(c)];
+}
 
-	if (topA >= bottomB)
-		return false;
+int LFontAtlas::getLineSkip()
+{
+	return mLineSkip;
+}
 
-	if (rightA <= leftB)
-		return false;
+int LFontAtlas::getFontHeight()
+{
+	return mFontHeight;
+}
 
-	if (leftA >= rightB)
-		return false;
+SDL_Texture* LFontAtlas::getTexture()
+{
+	return mTexture;
+}
 
-	//If none of the sides from A are outside B
-	return true;
+int LFontAtlas::getWidth()
+{
+	return mWidth;
 }
 
-void Enemy::move()
+int LFontAtlas::getHeight()
 {
-	if (isAlive)
-	{
-	}
-	else
-	{
-		eColliderUp.y = 0 - ENEMY_HEIGHT;
-		eColliderUp.x = 0 - ENEMY_WIDTH;
-		eColliderDown.y = 0 - ENEMY_HEIGHT;
-		eColliderDown.x = 0 - ENEMY_WIDTH;
-		eColliderLeft.y = 0 - ENEMY_HEIGHT;
-		eColliderLeft.x = 0 - ENEMY_WIDTH;
-		eColliderRight.y = 0 - ENEMY_HEIGHT;
-		eColliderRight.x = 0 - ENEMY_WIDTH;
-	}
+	return mHeight;
 }
 
-bool Enemy::render(SDL_Rect& playerBullet, Player& playerObj, int& ballXDir,
-	int& ballYDir, SDL_Rect& ballRect)
+LText::LText()
 {
-	if (checkCollision(ballRect, eColliderUp) && ballYDir == +3)
-	{
-		Mix_PlayChannel(-1, gBounce, 0);
-		ballYDir = -3;
-		if (ballXDir == -3)
-			ballXDir = +3;
-		if (ballXDir == +3)
-			ballXDir = -3;
-		healthPoints--;
-	}
-	if (checkCollision(ballRect, eColliderDown) && ballYDir == -3)
-	{
-		Mix_PlayChannel(-1, gBounce, 0);
-		ballYDir = +3;
-		if (ballXDir == -3)
-			ballXDir = +3;
-		if (ballXDir == +3)
-			ballXDir = -3;
-		healthPoints--;
-		isAlive = false;
-	}
-	if (checkCollision(ballRect, eColliderLeft) && ballYDir == -3)
-	{
-		Mix_PlayChannel(-1, gBounce, 0);
-		ballXDir = -3;
-		healthPoints--;
-		isAlive = false;
-	}
-	if (checkCollision(ballRect, eColliderRight) && ballYDir == -3)
-	{
-		Mix_PlayChannel(-1, gBounce, 0);
-		ballXDir = +3;
-		healthPoints--;
-		isAlive = false;
-	}
-	if (checkCollision(eColliderDown, playerBullet))
-	{
-		Mix_PlayChannel(-1, gBounce, 0);
-		ballXDir = -3;
-		healthPoints--;
-		isAlive = false;
-	}
-	else
-	{
-		if (healthPoints == 1)
-			isAlive = true;
-		else if (healthPoints == 0)
-			isAlive = false;
-		if (isAlive)
-		{
+	//Initialize
+	mPosX = 0;
+	mPosY = 0;
+	mWidth = 0;
+	mHeight = 0;
+}
 
-			SDL_SetRenderDrawColor(gRenderer, 0x00, 0xFF, 0xFF, 0xFF);
-			SDL_RenderFillRect(gRenderer, &eRect);
+void LText::setText(const std::string& text)
+{
+	//Nothing to rebuild if the string is the same
+	if (text == mText && !mVertices.empty())
+		return;
 
-			/* To see the collision of the box
-			SDL_SetRenderDrawColor(gRenderer, 0x00, 0x00, 0xFF, 0xFF);
-			SDL_RenderDrawRect(gRenderer, &eColliderUp);
+	mText = text;
+	mVertices.clear();
+	mIndices.clear();
+	mWidth = 0;
+	mHeight = 0;
 
-			SDL_SetRenderDrawColor(gRenderer, 0x00, 0x00, 0xFF, 0xFF);
-			SDL_RenderDrawRect(gRenderer, &eColliderDown);
+	if (gFontAtlas.getTexture() == NULL)
+		return;
 
-			SDL_SetRenderDrawColor(gRenderer, 0x00, 0x00, 0xFF, 0xFF);
-			SDL_RenderDrawRect(gRenderer, &eColliderRight);
+	float texW = (float)gFontAtlas.getWidth();
+	float texH = (float)gFontAtlas.getHeight();
+	SDL_Color white = { 0xFF, 0xFF, 0xFF, 0xFF };
 
-			SDL_SetRenderDrawColor(gRenderer, 0x00, 0x00, 0xFF, 0xFF);
-			SDL_RenderDrawRect(gRenderer, &eColliderLeft);
-			*/
-			return true;
+	//Lay the glyphs out from the origin, lines are centered on the widest one
+	std::vector<int> lineStarts;
+	std::vector<int> lineWidths;
+	int penX = 0;
+	int penY = 0;
+	lineStarts.push_back(0);
+	for (size_t i = 0; i < mText.size(); i++)
+	{
+		char c = mText[i];
+		if (c == '\n')
+		{
+			lineWidths.push_back(penX);
+			lineStarts.push_back((int)mVertices.size());
+			penX = 0;
+			penY += gFontAtlas.getLineSkip();
+			continue;
 		}
-		else if (!isAlive)
+
+		SDL_Rect clip = gFontAtlas.getClip(c);
+		if (clip.w > 0 && clip.h > 0)
 		{
-			if (point == false)
-			{
-				playerObj.score += 100;
-				playerObj.textScore = std::to_string(playerObj.score);
-				point = true;
-			}
-			return false;
+			int base = (int)mVertices.size();
+			float x0 = (float)penX, y0 = (float)penY;
+			float x1 = x0 + clip.w, y1 = y0 + clip.h;
+			float u0 = clip.x / texW, v0 = clip.y / texH;
+			float u1 = (clip.x + clip.w) / texW, v1 = (clip.y + clip.h) / texH;
+
+			mVertices.push_back({ { x0, y0 }, white, { u0, v0 } });
+			mVertices.push_back({ { x1, y0 }, white, { u1, v0 } });
+			mVertices.push_back({ { x1, y1 }, white, { u1, v1 } });
+			mVertices.push_back({ { x0, y1 }, white, { u0, v1 } });
+
+			mIndices.push_back(base);
+			mIndices.push_back(base + 1);
+			mIndices.push_back(base + 2);
+			mIndices.push_back(base);
+			mIndices.push_back(base + 2);
+			mIndices.push_back(base + 3);
 		}
-		return false;
+		penX += gFontAtlas.getAdvance(c);
+	}
+	lineWidths.push_back(penX);
+
+	for (size_t i = 0; i < lineWidths.size(); i++)
+		if (lineWidths[i] > mWidth)
+			mWidth = lineWidths[i];
+	mHeight = penY + gFontAtlas.getFontHeight();
+
+	for (size_t line = 0; line < lineStarts.size(); line++)
+	{
+		size_t end = line + 1 < lineStarts.size() ? lineStarts[line + 1] : mVertices.size();
+		float shift = (float)((mWidth - lineWidths[line]) / 2);
+		for (size_t v = lineStarts[line]; v < end; v++)
+			mVertices[v].position.x += shift;
 	}
 
-	return false;
+	//The quads are at the origin again
+	mPosX = 0;
+	mPosY = 0;
 }
 
-void Enemy::reset(int posX, int posY)
+void LText::render(int x, int y)
 {
-	ePosX = posX;
-	ePosY = posY;
+	if (mVertices.empty())
+		return;
 
-	eRect.w = ENEMY_WIDTH;
-	eRect.h = ENEMY_HEIGHT;
-	eRect.x = ePosX;
-	eRect.y = ePosY;
-	eColliderUp.w = ENEMY_WIDTH - 4;
-	eColliderUp.h = ENEMY_HEIGHT / 2;
-	eColliderUp.x = ePosX + 2;
-	eColliderUp.y = ePosY;
+	//Only move the quads when the text moved
+	if (x != mPosX || y != mPosY)
+	{
+		float dx = (float)(x - mPosX);
+		float dy = (float)(y - mPosY);
+		for (size_t i = 0; i < mVertices.size(); i++)
+		{
+			mVertices[i].position.x += dx;
+			mVertices[i].position.y += dy;
+		}
+		mPosX = x;
+		mPosY = y;
+	}
+
+	//Draw every glyph with one batched copy out of the atlas
+	SDL_RenderGeometry(gRenderer, gFontAtlas.getTexture(), &mVertices[0], (int)mVertices.size(), &mIndices[0], (int)mIndices.size());
+	gDrawStats.calls++;
+}
+
+int LText::getWidth()
+{
+	return mWidth;
+}
+
+int LText::getHeight()
+{
+	return mHeight;
+}
+
+Player::Player()
+{
+	score = 0;
+	textScore = std::to_string(score);
+}
+
+void Player::handleEvent(SDL_Event& e)
+{
+	//Which key bit the event is about
+	unsigned char key = 0;
+	if ((e.type == SDL_KEYDOWN || e.type == SDL_KEYUP) && e.key.repeat == 0)
+	{
+		switch (e.key.keysym.sym)
+		{
+		case SDLK_UP: key = KEY_UP; break;
+		case SDLK_DOWN: key = KEY_DOWN; break;
+		case SDLK_LEFT: key = KEY_LEFT; break;
+		case SDLK_RIGHT: key = KEY_RIGHT; break;
+		case SDLK_SPACE: key = KEY_SPACE; break;
+		}
+	}
+
+	//If a key was pressed
+	if (e.type == SDL_KEYDOWN)
+		input.keys |= key;
+	//If a key was released
+	else if (e.type == SDL_KEYUP)
+		input.keys &= ~key;
+}
+
+void Player::setScore(int newScore)
+{
+	if (newScore != score)
+	{
+		score = newScore;
+		textScore = std::to_string(score);
+	}
+}
+
+void Player::setScores(int first, int second)
+{
+	if (first != score || second != score2)
+	{
+		score = first;
+		score2 = second;
+		textScore = std::to_string(score) + " : " + std::to_string(score2);
+	}
+}
+
+void Player::render(const Paddle& paddle, float alpha)
+{
+	//display the player on the screen
+	float x = paddle.mPrevPosX + (paddle.mPosX - paddle.mPrevPosX) * alpha;
+	gPlayerTexture.render((int)x, (int)paddle.mPosY);
+}
+
+LSoundDispatcher::LSoundDispatcher()
+{
+	for (int i = 0; i < SOUND_COUNT; i++)
+		mChunks[i] = NULL;
+	mRequested = 0;
+	mPlayed = 0;
+	mCoalesced = 0;
+	mStolen = 0;
+}
+
+bool LSoundDispatcher::init()
+{
+	//Channels s * VOICES_PER_SOUND and up belong to sample s
+	Mix_AllocateChannels(SOUND_COUNT * VOICES_PER_SOUND);
+	for (int i = 0; i < SOUND_COUNT; i++)
+	{
+		int first = i * VOICES_PER_SOUND;
+		if (Mix_GroupChannels(first, first + VOICES_PER_SOUND - 1, i) != VOICES_PER_SOUND)
+		{
+			printf("Unable to group the sound channels! SDL_mixer Error: %s\n", Mix_GetError());
+			return false;
+		}
+	}
+	return true;
+}
+
+void LSoundDispatcher::setChunk(int sound, Mix_Chunk* chunk)
+{
+	mChunks[sound] = chunk;
+}
+
+void LSoundDispatcher::dispatch()
+{
+	//Which samples were asked for at least once this frame
+	bool wanted[SOUND_COUNT] = { false };
+
+	SoundEvent event;
+	while (gSoundQueue.pop(event))
+	{
+		mRequested++;
+		if (event.sound >= SOUND_COUNT)
+			continue;
+		if (wanted[event.sound])
+			mCoalesced++;
+		wanted[event.sound] = true;
+	}
+
+	for (int i = 0; i < SOUND_COUNT; i++)
+	{
+		if (!wanted[i] || mChunks[i] == NULL)
+			continue;
+
+		//A free voice of the sample's own, or the one that has played longest
+		int channel = Mix_GroupAvailable(i);
+		if (channel == -1)
+		{
+			channel = Mix_GroupOldest(i);
+			mStolen++;
+		}
+		if (channel != -1 && Mix_PlayChannel(channel, mChunks[i], 0) != -1)
+			mPlayed++;
+	}
+}
+
+void LSoundDispatcher::report(int dropped)
+{
+	printf("Sounds: %d asked for, %d played, %d merged within a frame, %d cut off a busy voice, %d dropped from a full queue\n",
+		mRequested + dropped, mPlayed, mCoalesced, mStolen, dropped);
+}
+
+//Queues the sounds for what happened during the last step, nothing is
+// played until the dispatcher runs
+void queueSounds(const std::vector<GameEvent>& events)
+{
+	for (size_t i = 0; i < events.size(); i++)
+	{
+		if (events[i].type == EVENT::BOUNCE)
+		{
+			SoundEvent event = { SOUND_BOUNCE };
+			if (!gSoundQueue.push(event))
+				gDroppedSounds++;
+		}
+	}
+}
+
+//Colors the brick types are drawn in, types past the end wrap around
+const SDL_Color BRICK_COLORS[] = {
+	{ 0x00, 0xFF, 0xFF, 0xFF },
+	{ 0x00, 0xCC, 0xFF, 0xFF },
+	{ 0x00, 0x99, 0xFF, 0xFF }
+};
+const int BRICK_COLOR_COUNT = sizeof(BRICK_COLORS) / sizeof(BRICK_COLORS[0]);
+
+//Rects of the standing bricks, one list per color, kept between frames
+std::vector<SDL_Rect> gBrickBatches[BRICK_COLOR_COUNT];
+
+//Adds the frame that was just presented to the totals and prints them once a second
+void reportDrawStats()
+{
+	DrawStats& stats = gDrawStats;
+	stats.frames++;
+	stats.totalCalls += stats.calls;
+	stats.totalBrickCalls += stats.brickCalls;
+	stats.totalBrickRects += stats.brickRects;
+	stats.calls = 0;
+	stats.brickCalls = 0;
+	stats.brickRects = 0;
+
+	Uint32 now = SDL_GetTicks();
+	if (now - stats.lastReport < 1000)
+		return;
+	if (gDrawStatsEnabled && stats.frames > 0)
+	{
+		printf("Draw calls per frame: %.1f (bricks: %.1f calls for %.1f bricks, %s)\n",
+			(double)stats.totalCalls / stats.frames,
+			(double)stats.totalBrickCalls / stats.frames,
+			(double)stats.totalBrickRects / stats.frames,
+			gUnbatchedBricks ? "one call per brick" : gBrickLayer.isReady() ? "cached layer" : "batched by color");
+	}
+	stats.frames = 0;
+	stats.totalCalls = 0;
+	stats.totalBrickCalls = 0;
+	stats.totalBrickRects = 0;
+	stats.lastReport = now;
+}
+
+//Draws the standing bricks the old way, a color change and a fill for every one
+void renderBricksUnbatched(const BrickGrid& bricks)
+{
+	for (int i = 0; i < (int)bricks.size(); i++)
+	{
+		if (bricks.isAlive(i))
+		{
+			Rect rect = bricks.getRect(i);
+			SDL_Rect eRect = { rect.x, rect.y, rect.w, rect.h };
+			const SDL_Color& color = BRICK_COLORS[bricks.getLayout()->type[i] % BRICK_COLOR_COUNT];
+			SDL_SetRenderDrawColor(gRenderer, color.r, color.g, color.b, color.a);
+			SDL_RenderFillRect(gRenderer, &eRect);
+			gDrawStats.calls++;
+			gDrawStats.brickCalls++;
+			gDrawStats.brickRects++;
+		}
+	}
+}
+
+//Draws the standing bricks with one fill call per color, however many there are
+void renderBricks(const BrickGrid& bricks)
+{
+	for (int c = 0; c < BRICK_COLOR_COUNT; c++)
+		gBrickBatches[c].clear();
+
+	//Only visit the bricks that are standing
+	const BrickLayout& layout = *bricks.getLayout();
+	const std::vector<uint64_t>& alive = bricks.getAliveBits();
+	for (size_t word = 0; word < alive.size(); word++)
+	{
+		uint64_t bits = alive[word];
+		while (bits != 0)
+		{
+			int i = (int)(word * 64) + lowestBit(bits);
+			bits &= bits - 1;
+
+			SDL_Rect eRect = { layout.posX[i], layout.posY[i], layout.brickWidth, layout.brickHeight };
+			gBrickBatches[layout.type[i] % BRICK_COLOR_COUNT].push_back(eRect);
+		}
+	}
+
+	for (int c = 0; c < BRICK_COLOR_COUNT; c++)
+	{
+		const std::vector<SDL_Rect>& batch = gBrickBatches[c];
+		if (batch.empty())
+			continue;
+		SDL_SetRenderDrawColor(gRenderer, BRICK_COLORS[c].r, BRICK_COLORS[c].g, BRICK_COLORS[c].b, BRICK_COLORS[c].a);
+		SDL_RenderFillRects(gRenderer, &batch[0], (int)batch.size());
+		gDrawStats.calls++;
+		gDrawStats.brickCalls++;
+		gDrawStats.brickRects += (int)batch.size();
+	}
+}
+
+LBrickLayer::LBrickLayer()
+{
+	//Initialize
+	mTexture = NULL;
+	mWidth = 0;
+	mHeight = 0;
+	mDirty = true;
+}
+
+LBrickLayer::~LBrickLayer()
+{
+	//Deallocate
+	free();
+}
 
-	eColliderDown.w = ENEMY_WIDTH - 4;
-	eColliderDown.h = ENEMY_HEIGHT / 2;
-	eColliderDown.x = ePosX + 2;
-	eColliderDown.y = ePosY + ENEMY_HEIGHT / 2;
+bool LBrickLayer::create(int width, int height)
+{
+	//Get rid of preexisting texture
+	free();
+
+	if (!SDL_RenderTargetSupported(gRenderer))
+	{
+		printf("The renderer can't draw into textures, bricks will be drawn every frame\n");
+		return false;
+	}
+
+	mTexture = SDL_CreateTexture(gRenderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET, width, height);
+	if (mTexture == NULL)
+	{
+		printf("Unable to create brick layer! SDL Error: %s\n", SDL_GetError());
+		return false;
+	}
+
+	//Where there are no bricks the layer is see through
+	SDL_SetTextureBlendMode(mTexture, SDL_BLENDMODE_BLEND);
+	mWidth = width;
+	mHeight = height;
+	mDirty = true;
+	return true;
+}
+
+void LBrickLayer::free()
+{
+	if (mTexture != NULL)
+	{
+		SDL_DestroyTexture(mTexture);
+		mTexture = NULL;
+		mWidth = 0;
+		mHeight = 0;
+	}
+}
+
+void LBrickLayer::invalidate()
+{
+	mDirty = true;
+}
+
+void LBrickLayer::eraseBrick(const BrickGrid& bricks, int brick)
+{
+	//The whole layer is about to be drawn again anyway
+	if (mTexture == NULL || mDirty)
+		return;
+
+	Rect rect = bricks.getRect(brick);
+	SDL_Rect eRect = { rect.x, rect.y, rect.w, rect.h };
+
+	//Write see through pixels over the brick instead of blending onto it
+	SDL_SetRenderTarget(gRenderer, mTexture);
+	SDL_SetRenderDrawBlendMode(gRenderer, SDL_BLENDMODE_NONE);
+	SDL_SetRenderDrawColor(gRenderer, 0x00, 0x00, 0x00, 0x00);
+	SDL_RenderFillRect(gRenderer, &eRect);
+	SDL_SetRenderTarget(gRenderer, NULL);
+	gDrawStats.calls++;
+	gDrawStats.brickCalls++;
+}
+
+void LBrickLayer::rebuild(const BrickGrid& bricks)
+{
+	SDL_SetRenderTarget(gRenderer, mTexture);
+	SDL_SetRenderDrawBlendMode(gRenderer, SDL_BLENDMODE_NONE);
+	SDL_SetRenderDrawColor(gRenderer, 0x00, 0x00, 0x00, 0x00);
+	SDL_RenderClear(gRenderer);
+	renderBricks(bricks);
+	SDL_SetRenderTarget(gRenderer, NULL);
+	mDirty = false;
+}
+
+void LBrickLayer::render(const BrickGrid& bricks)
+{
+	if (mDirty)
+		rebuild(bricks);
+
+	//The whole wall in one copy, however many bricks it has
+	SDL_Rect renderQuad = { 0, 0, mWidth, mHeight };
+	SDL_RenderCopy(gRenderer, mTexture, NULL, &renderQuad);
+	gDrawStats.calls++;
+	gDrawStats.brickCalls++;
+	gDrawStats.brickRects += bricks.getAliveCount();
+}
+
+bool LBrickLayer::isReady()
+{
+	return mTexture != NULL;
+}
+
+//Cuts the bricks destroyed during the last step out of the brick layer
+void eraseBricks(const std::vector<GameEvent>& events, const BrickGrid& bricks)
+{
+	for (size_t i = 0; i < events.size(); i++)
+	{
+		if (events[i].type == EVENT::BRICK_DESTROYED)
+			gBrickLayer.eraseBrick(bricks, events[i].brick);
+	}
+}
+
+//Throws debris out of the bricks destroyed during the last step
+void spawnDebris(const std::vector<GameEvent>& events, const BrickGrid& bricks)
+{
+	for (size_t i = 0; i < events.size(); i++)
+	{
+		if (events[i].type != EVENT::BRICK_DESTROYED)
+			continue;
+		int brick = events[i].brick;
+		gParticles.spawnBurst(bricks.getRect(brick), gDebrisPerBrick, bricks.getLayout()->type[brick] % BRICK_COLOR_COUNT, gDebrisRandom);
+	}
+}
+
+//Draws every particle with one call, fading them out as they run out of life
+void renderParticles()
+{
+	//Kept between frames, they only ever grow to the pool's capacity
+	static std::vector<SDL_Vertex> vertices;
+	static std::vector<int> indices;
+
+	size_t count = gParticles.size();
+	if (count == 0)
+		return;
+
+	//The indices are the same for every frame, they only get added to
+	if (indices.size() < count * 6)
+	{
+		size_t first = indices.size() / 6;
+		indices.resize(count * 6);
+		for (size_t i = first; i < count; i++)
+		{
+			int base = (int)i * 4;
+			int* quad = &indices[i * 6];
+			quad[0] = base;
+			quad[1] = base + 1;
+			quad[2] = base + 2;
+			quad[3] = base;
+			quad[4] = base + 2;
+			quad[5] = base + 3;
+		}
+	}
+
+	vertices.resize(count * 4);
+	const float size = (float)PARTICLE_SIZE;
+	for (size_t i = 0; i < count; i++)
+	{
+		SDL_Color color = BRICK_COLORS[gParticles.color[i]];
+		color.a = (Uint8)(255.0f * gParticles.life[i] / gParticles.maxLife[i]);
+		float x0 = gParticles.x[i], y0 = gParticles.y[i];
+		SDL_Vertex* quad = &vertices[i * 4];
+		quad[0] = { { x0, y0 }, color, { 0.0f, 0.0f } };
+		quad[1] = { { x0 + size, y0 }, color, { 0.0f, 0.0f } };
+		quad[2] = { { x0 + size, y0 + size }, color, { 0.0f, 0.0f } };
+		quad[3] = { { x0, y0 + size }, color, { 0.0f, 0.0f } };
+	}
 
-	eColliderRight.w = ENEMY_WIDTH / 2;
-	eColliderRight.h = ENEMY_HEIGHT - 4;
-	eColliderRight.x = ePosX + ENEMY_WIDTH / 2;
-	eColliderRight.y = ePosY + 2;
+	SDL_SetRenderDrawBlendMode(gRenderer, SDL_BLENDMODE_BLEND);
+	SDL_RenderGeometry(gRenderer, NULL, &vertices[0], (int)(count * 4), &indices[0], (int)(count * 6));
+	gDrawStats.calls++;
+}
+
+//Draws the ball and every brick that is still standing, alpha is how far
+// between the last two steps the frame is
+void renderPlay(const GameState& state, float alpha)
+{
+	//Every ball in one go, there can be thousands
+	static std::vector<SDL_Rect> ballRects;
+	const BallSet& balls = state.balls;
+	ballRects.resize(balls.size());
+	for (size_t i = 0; i < balls.size(); i++)
+	{
+		float ballX = balls.prevX[i] + (balls.x[i] - balls.prevX[i]) * alpha;
+		float ballY = balls.prevY[i] + (balls.y[i] - balls.prevY[i]) * alpha;
+		ballRects[i] = { (int)ballX, (int)ballY, Ball::BALL_SIZE, Ball::BALL_SIZE };
+	}
+	SDL_SetRenderDrawColor(gRenderer, 0xFF, 0xFF, 0xFF, 0xFF);
+	if (!ballRects.empty())
+	{
+		SDL_RenderFillRects(gRenderer, &ballRects[0], (int)ballRects.size());
+		gDrawStats.calls++;
+	}
 
-	eColliderLeft.w = ENEMY_WIDTH / 2 + 2;
-	eColliderLeft.h = ENEMY_HEIGHT - 4;
-	eColliderLeft.x = ePosX;
-	eColliderLeft.y = ePosY;
-	eVel = 4;
+	if (gUnbatchedBricks)
+		renderBricksUnbatched(state.bricks);
+	else if (gBrickLayer.isReady())
+		gBrickLayer.render(state.bricks);
+	else
+		renderBricks(state.bricks);
 
-	isAlive = true;
-	healthPoints = 1;
-	point = false;
+	renderParticles();
 }
 
 bool init()
@@ -622,6 +1366,13 @@ bool init()
 	//Initialization flag
 	bool success = true;
 
+	//Offscreen there is no display and nobody listening
+	if (gOffscreenFrames > 0)
+	{
+		SDL_setenv("SDL_VIDEODRIVER", "dummy", 1);
+		SDL_setenv("SDL_AUDIODRIVER", "dummy", 1);
+	}
+
 	//Initialize SDL Subsystems 
 	if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_JOYSTICK) < 0)
 	{
@@ -643,17 +1394,23 @@ bool init()
 			if (gGameController == NULL)
 				printf("Warning: unable to use the game controller SDL Error: %s\n", SDL_GetError());
 		}
-		//Create window
-		gWindow = SDL_CreateWindow("Patrick's Super Duper Radical Brick Breaker Sensation", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, SCREEN_WIDTH, SCREEN_HEIGHT, SDL_WINDOW_SHOWN);
-		if (gWindow == NULL)
+		//Create window, or the surface the frames get drawn into offscreen
+		if (gOffscreenFrames > 0)
+			gOffscreenSurface = SDL_CreateRGBSurfaceWithFormat(0, SCREEN_WIDTH, SCREEN_HEIGHT, 32, SDL_PIXELFORMAT_ARGB8888);
+		else
+			gWindow = SDL_CreateWindow("Patrick's Super Duper Radical Brick Breaker Sensation", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, SCREEN_WIDTH, SCREEN_HEIGHT, SDL_WINDOW_SHOWN);
+		if (gWindow == NULL && gOffscreenSurface == NULL)
 		{
 			printf("Window could not be created! SDL Error: %s\n", SDL_GetError());
 			success = false;
 		}
 		else
 		{
-			//Create vsynced renderer for window
-			gRenderer = SDL_CreateRenderer(gWindow, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
+			//Create vsynced renderer for window, or a software one for the surface
+			if (gOffscreenSurface != NULL)
+				gRenderer = SDL_CreateSoftwareRenderer(gOffscreenSurface);
+			else
+				gRenderer = SDL_CreateRenderer(gWindow, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
 			if (gRenderer == NULL)
 			{
 				printf("Renderer could not be created! SDL Error: %s\n", SDL_GetError());
@@ -664,6 +1421,16 @@ bool init()
 				//Initialize renderer color
 				SDL_SetRenderDrawColor(gRenderer, 0xFF, 0xFF, 0xFF, 0xFF);
 
+				//Not every driver can give us vsync
+				SDL_RendererInfo info;
+				if (SDL_GetRendererInfo(gRenderer, &info) == 0)
+					gVsync = (info.flags & SDL_RENDERER_PRESENTVSYNC) != 0;
+				//Uncapped frames don't wait for the display either
+				if (gUncapped && gVsync && SDL_RenderSetVSync(gRenderer, 0) == 0)
+					gVsync = false;
+				if (!gVsync && !gUncapped)
+					printf("Warning: No vsync, pacing frames to the tick rate\n");
+
 				//Initialize PNG loading
 				int imgFlags = IMG_INIT_PNG;
 				if (!(IMG_Init(imgFlags) & imgFlags))
@@ -672,12 +1439,19 @@ bool init()
 					success = false;
 				}
 
+				//Ogg Vorbis for the music, plain WAV needs no decoder
+				if (!(Mix_Init(MIX_INIT_OGG) & MIX_INIT_OGG))
+					printf("Warning: no Ogg Vorbis decoder, music will only play from WAV. SDL_mixer Error: %s\n", Mix_GetError());
+
 				//Initialize SDL_mixer
 				if (Mix_OpenAudio(22050, MIX_DEFAULT_FORMAT, 2, 2048) < 0)
 				{
 					printf("SDL_mixer could not initialize! SDL_mixer Error: %s\n", Mix_GetError());
 					success = false;
 				}
+				//Every sample gets a bounded set of voices
+				else if (!gSounds.init())
+					success = false;
 
 				//Initialize SDL_ttf
 				if (TTF_Init() == -1)
@@ -692,32 +1466,157 @@ bool init()
 	return success;
 }
 
+//Milliseconds since the program started
+double millisecondsSinceStart()
+{
+	return (SDL_GetPerformanceCounter() - gStartCounter) * 1000.0 / SDL_GetPerformanceFrequency();
+}
+
+//Opens an asset out of the pack, or from its loose file if the pack doesn't have it
+SDL_RWops* openAsset(const char* name)
+{
+	size_t size;
+	const unsigned char* data = gPack.find(name, size);
+	if (data != NULL)
+		return SDL_RWFromConstMem(data, (int)size);
+	return SDL_RWFromFile(name, "rb");
+}
+
+//Prints how much the resident size of the process moved since before
+// something was loaded
+void reportMemory(const char* what, size_t residentBefore)
+{
+	size_t resident = getResidentBytes();
+	if (resident == 0)
+		return;
+	printf("Memory: %s loaded, resident %.1f MB -> %.1f MB (%+.0f KB)\n", what,
+		residentBefore / 1048576.0, resident / 1048576.0, ((double)resident - (double)residentBefore) / 1024.0);
+}
+
+//Opens the music, streamed and decoded a buffer at a time while it plays.
+// The compressed track is preferred, the WAV is the fallback. Runs on the
+// main thread before the loader starts, so the memory report only counts
+// the music and not whatever the loader has decoded by then.
+bool loadMusic()
+{
+	size_t residentBefore = getResidentBytes();
+	const char* musicName = MUSIC_OGG;
+	SDL_RWops* musicFile = openAsset(MUSIC_OGG);
+	if (musicFile == NULL)
+	{
+		musicName = MUSIC_WAV;
+		musicFile = openAsset(MUSIC_WAV);
+	}
+	gMusic = Mix_LoadMUS_RW(musicFile, 1);
+	if (gMusic == NULL)
+	{
+		printf("Failed to load beat music! SDL_mixer Error: %s\n", Mix_GetError());
+		return false;
+	}
+	reportMemory(musicName, residentBefore);
+	return true;
+}
+
+//Decodes everything the menu doesn't need, runs on the loader thread
+int loadAssets(void* data)
+{
+	AssetLoader* loader = (AssetLoader*)data;
+	loader->success = true;
+
+	//Decode the player image, the texture has to be made on the main thread
+	loader->playerSurface = IMG_Load_RW(openAsset("Player.bmp"), 1);
+	if (loader->playerSurface == NULL)
+	{
+		printf("Failed to load player texture! SDL_image Error: %s\n", IMG_GetError());
+		loader->success = false;
+	}
+	else
+	{
+		//Color key image
+		SDL_SetColorKey(loader->playerSurface, SDL_TRUE, SDL_MapRGB(loader->playerSurface->format, 0, 0xFF, 0xFF));
+	}
+
+	//Load sound effects
+	loader->bounce = Mix_LoadWAV_RW(openAsset("Bounce.wav"), 1);
+	if (loader->bounce == NULL)
+	{
+		printf("Failed to load scratch sound effect! SDL_mixer Error: %s\n", Mix_GetError());
+		loader->success = false;
+	}
+
+	loader->done = true;
+	return 0;
+}
+
+//Hands what the loader decoded over to the game. Without wait it only
+// does so if the loader is already done. Returns false if an asset failed.
+bool finishLoading(bool wait)
+{
+	if (gAssetsReady)
+		return gLoader.success;
+	if (!gLoader.done && (!wait || gLoader.thread == NULL))
+		return true;
+
+	if (gLoader.thread != NULL)
+		SDL_WaitThread(gLoader.thread, NULL);
+	gLoader.thread = NULL;
+
+	//Textures can only be made where the renderer lives
+	if (gLoader.playerSurface != NULL && !gPlayerTexture.loadFromSurface(gLoader.playerSurface))
+		gLoader.success = false;
+	gLoader.playerSurface = NULL;
+
+	gBounce = gLoader.bounce;
+	gSounds.setChunk(SOUND_BOUNCE, gBounce);
+	gAssetsReady = true;
+	printf("Assets ready after %.1f ms\n", millisecondsSinceStart());
+
+	//If there is no music playing
+	if (gMusic != NULL && Mix_PlayingMusic() == 0)
+		Mix_PlayMusic(gMusic, -1);//Play the music
+
+	if (!gLoader.success)
+		printf("Failed to load media!\n");
+	return gLoader.success;
+}
+
 bool loadMedia()
 {
 	//Loading success flag
 	bool success = true;
 
-	//Load player texture
-	if (!gPlayerTexture.loadFromFile("Player.bmp"))
+	//Map the asset pack
+	if (!gPack.open(ASSET_PACK_PATH))
+		printf("No asset pack, loading loose files\n");
+
+	//The font is needed for the first frame, so it is loaded right away
+	gFont = TTF_OpenFontRW(openAsset("04B_19__.ttf"), 1, 28);
+	if (gFont == NULL)
 	{
-		printf("Failed to load player texture!\n");
+		printf("Failed to load lazy font! SDL_ttf Error: %s\n", TTF_GetError());
 		success = false;
 	}
-
-	//Load music
-	gMusic = Mix_LoadMUS("Patrick is good at making music.wav");
-	if (gMusic == NULL)
+	else if (!gFontAtlas.loadFromFont(gFont))
 	{
-		printf("Failed to load beat music! SDL_mixer Error: %s\n", Mix_GetError());
+		printf("Failed to build the glyph atlas!\n");
 		success = false;
 	}
 
-	//Load sound effects 
-	gBounce = Mix_LoadWAV("Bounce.wav");
-	if (gBounce == NULL)
-	{
-		printf("Failed to load scratch sound effect! SDL_mixer Error: %s\n", Mix_GetError());
+	//Bricks get drawn straight to the screen if there can't be a layer
+	gBrickLayer.create(SCREEN_WIDTH, SCREEN_HEIGHT);
+
+	//Only opening the stream, it plays once the rest is in
+	if (!loadMusic())
 		success = false;
+
+	//Everything else loads while the menu is up
+	gLoader.thread = SDL_CreateThread(loadAssets, "AssetLoader", &gLoader);
+	if (gLoader.thread == NULL)
+	{
+		printf("Warning: unable to start the loader thread, loading now. SDL Error: %s\n", SDL_GetError());
+		loadAssets(&gLoader);
+		if (!finishLoading(true))
+			success = false;
 	}
 
 	return success;
@@ -725,9 +1624,13 @@ bool loadMedia()
 
 void close()
 {
+	//The loader may still be busy with the pack
+	finishLoading(true);
+
 	//Free loaded images
 	gPlayerTexture.free();
-	gTextTexture.free();
+	gFontAtlas.free();
+	gBrickLayer.free();
 
 	//Free the music Chunk
 	Mix_FreeChunk(gBounce);
@@ -747,11 +1650,16 @@ void close()
 	Mix_FreeMusic(gMusic);
 	gMusic = NULL;
 
+	//The assets read straight out of the pack are gone, so it can go too
+	gPack.close();
+
 	//Destroy window	
 	SDL_DestroyRenderer(gRenderer);
 	SDL_DestroyWindow(gWindow);
+	SDL_FreeSurface(gOffscreenSurface);
 	gWindow = NULL;
 	gRenderer = NULL;
+	gOffscreenSurface = NULL;
 
 	//Quit SDL subsystems
 	TTF_Quit();
@@ -760,6 +1668,394 @@ void close()
 	SDL_Quit();
 }
 
+//Presses and lets go of keys for the player the way the keyboard would,
+// so the autopilot drives the same input path as a person does
+void pressKeys(Player& player, const Input& wanted)
+{
+	static const struct { unsigned char key; SDL_Keycode sym; } KEYS[] = {
+		{ KEY_LEFT, SDLK_LEFT }, { KEY_RIGHT, SDLK_RIGHT }, { KEY_UP, SDLK_UP }, { KEY_DOWN, SDLK_DOWN }, { KEY_SPACE, SDLK_SPACE }
+	};
+
+	for (size_t i = 0; i < sizeof(KEYS) / sizeof(KEYS[0]); i++)
+	{
+		bool held = (player.input.keys & KEYS[i].key) != 0;
+		bool want = (wanted.keys & KEYS[i].key) != 0;
+		if (held == want)
+			continue;
+
+		SDL_Event e;
+		SDL_zero(e);
+		e.type = want ? SDL_KEYDOWN : SDL_KEYUP;
+		e.key.state = want ? SDL_PRESSED : SDL_RELEASED;
+		e.key.keysym.sym = KEYS[i].sym;
+		player.handleEvent(e);
+	}
+}
+
+//The game being played and shown, the versus session's if there is one
+const Game& playedGame(const Game& local)
+{
+	return gVersus != NULL ? gVersus->getGame() : local;
+}
+
+//Steps the game with the player's keys, or with the recorded ones while
+// a replay plays, and records the keys that were used if asked to. In a
+// versus game the keys go to the session, which may have to wait a step
+// for the other end. Returns false if no step was played, so the events
+// of the last one are still there and mustn't be handed out again.
+bool stepGame(Game& local, Player& player)
+{
+	const Game& game = playedGame(local);
+
+	//The autopilot decides what the player is holding
+	if (gAutopilot != NULL && gReplayPath == NULL)
+		pressKeys(player, gAutopilot->next(game.getState()));
+
+	Input input = player.input;
+	if (gReplayPath != NULL && !gReplayCursor.next(input))
+	{
+		//Out of steps, so the game should be where it was when it was recorded
+		if (isRunning)
+		{
+			uint64_t hash = hashState(game.getState());
+			printf("Replay finished after %u steps, final state %s the recording\n", gReplayCursor.getStep(),
+				hash == gReplay.finalHash ? "matches" : "DOESN'T match");
+		}
+		isRunning = false;
+		return false;
+	}
+
+	if (gRecordPath != NULL)
+		gReplay.record(input);
+
+	GAMEMODE mode = game.getState().mode;
+	bool stepped = true;
+	if (gVersus != NULL)
+		stepped = gVersus->update(input);
+	else
+		local.step(input);
+
+	//Count the games the autopilot gets through
+	GAMEMODE now = game.getState().mode;
+	if (gAutopilot != NULL && mode == GAMEMODE::PLAY && now != GAMEMODE::PLAY)
+		gSoak.addGame(now == GAMEMODE::WIN);
+	return stepped;
+}
+
+//Handles the keys of the developer tools, F3 shows the profiler
+void handleDebugKeys(SDL_Event& e)
+{
+#ifdef BRICK_PROFILE
+	if (e.type == SDL_KEYDOWN && e.key.repeat == 0 && e.key.keysym.sym == SDLK_F3)
+		gProfileOverlay = !gProfileOverlay;
+#else
+	//No developer tools in this build
+	(void)e;
+#endif
+}
+
+#ifdef BRICK_PROFILE
+//Draws min/avg/p99 of every phase over the last few seconds in the top left corner
+void renderProfileOverlay()
+{
+	if (!gProfileOverlay)
+		return;
+
+	//The numbers only get laid out again a few times a second
+	Profiler& profiler = Profiler::get();
+	if (profiler.getFrameCount() % 15 == 0 || gProfileText.getWidth() == 0)
+	{
+		std::string text = "ms  min / avg / p99";
+		char line[96];
+		for (int i = 0; i < PROFILE_PHASE_COUNT; i++)
+		{
+			Profiler::Stats stats = profiler.getStats(i);
+			snprintf(line, sizeof(line), "\n%s  %.2f / %.2f / %.2f", Profiler::getPhaseName(i), stats.min, stats.avg, stats.p99);
+			text += line;
+		}
+		gProfileText.setText(text);
+	}
+
+	//Darken what is behind the numbers so they can be read
+	SDL_Rect background = { 0, 0, gProfileText.getWidth() + 16, gProfileText.getHeight() + 16 };
+	SDL_SetRenderDrawBlendMode(gRenderer, SDL_BLENDMODE_BLEND);
+	SDL_SetRenderDrawColor(gRenderer, 0x00, 0x00, 0x00, 0xC0);
+	SDL_RenderFillRect(gRenderer, &background);
+	gDrawStats.calls++;
+	gProfileText.render(8, 8);
+}
+#endif
+
+//Bookkeeping after every presented frame
+void endFrame()
+{
+	if (!gFirstFramePresented)
+	{
+		gFirstFramePresented = true;
+		printf("First frame presented after %.1f ms\n", millisecondsSinceStart());
+	}
+
+	//Pick up the assets as soon as the loader has them
+	if (!finishLoading(false))
+		isRunning = false;
+
+	reportDrawStats();
+
+	//How long the frame took and how the session is holding up
+	if (gAutopilot != NULL)
+	{
+		Uint64 counter = SDL_GetPerformanceCounter();
+		if (gLastFrameCounter != 0)
+			gSoak.addFrame((counter - gLastFrameCounter) / (double)SDL_GetPerformanceFrequency());
+		gLastFrameCounter = counter;
+		gSoak.report(stdout);
+	}
+}
+
+//Times, hashes and saves the frame that was just drawn offscreen, and
+// ends the session once enough frames were drawn
+void captureFrame()
+{
+	Uint64 counter = SDL_GetPerformanceCounter();
+	gOffscreenTimes.push_back((counter - gOffscreenFrameStart) / (double)SDL_GetPerformanceFrequency());
+
+	//Row by row, the pitch may have padding in it
+	SDL_Surface* surface = gOffscreenSurface;
+	uint64_t hash = HASH_START;
+	for (int row = 0; row < surface->h; row++)
+		hash = hashBytes((const unsigned char*)surface->pixels + row * surface->pitch, surface->w * 4, hash);
+	gOffscreenHashes.push_back(hash);
+
+	if (gDumpDir != NULL)
+	{
+		char path[512];
+		snprintf(path, sizeof(path), "%s/frame_%05d.bmp", gDumpDir, (int)gOffscreenHashes.size() - 1);
+		if (SDL_SaveBMP(surface, path) != 0)
+			printf("Unable to save %s! SDL Error: %s\n", path, SDL_GetError());
+	}
+
+	if ((int)gOffscreenHashes.size() >= gOffscreenFrames)
+		isRunning = false;
+
+	//The next frame starts now, not when the hash is done
+	gOffscreenFrameStart = SDL_GetPerformanceCounter();
+}
+
+//Prints how long the offscreen frames took to draw, writes their hashes and
+// compares them with the golden ones. Returns false if any frame differs.
+bool reportOffscreen()
+{
+	std::vector<double> sorted = gOffscreenTimes;
+	std::sort(sorted.begin(), sorted.end());
+	double total = 0.0;
+	for (size_t i = 0; i < sorted.size(); i++)
+		total += sorted[i];
+	size_t count = sorted.size();
+
+	if (gHashPath != NULL)
+	{
+		FILE* file = fopen(gHashPath, "w");
+		if (file == NULL)
+			printf("Unable to create %s!\n", gHashPath);
+		else
+		{
+			for (size_t i = 0; i < gOffscreenHashes.size(); i++)
+				fprintf(file, "%016llx\n", (unsigned long long)gOffscreenHashes[i]);
+			fclose(file);
+		}
+	}
+
+	//One hash per line, frame by frame
+	int compared = 0, different = 0, firstDifferent = -1;
+	if (gGoldenPath != NULL)
+	{
+		FILE* file = fopen(gGoldenPath, "r");
+		if (file == NULL)
+		{
+			printf("Unable to open %s!\n", gGoldenPath);
+			different = 1;
+		}
+		else
+		{
+			unsigned long long golden;
+			while (compared < (int)gOffscreenHashes.size() && fscanf(file, "%llx", &golden) == 1)
+			{
+				if (golden != gOffscreenHashes[compared])
+				{
+					if (firstDifferent < 0)
+						firstDifferent = compared;
+					different++;
+				}
+				compared++;
+			}
+
+			//Frames the golden file doesn't have, or has more of, count as different
+			int missing = (int)gOffscreenHashes.size() - compared;
+			int extra = 0;
+			while (fscanf(file, "%llx", &golden) == 1)
+				extra++;
+			fclose(file);
+			if (missing > 0)
+			{
+				printf("%s only has %d of the %d frames\n", gGoldenPath, compared, (int)gOffscreenHashes.size());
+				if (firstDifferent < 0)
+					firstDifferent = compared;
+				different += missing;
+			}
+			if (extra > 0)
+			{
+				printf("%s has %d frames more than the %d drawn\n", gGoldenPath, extra, (int)gOffscreenHashes.size());
+				if (firstDifferent < 0)
+					firstDifferent = compared;
+				different += extra;
+			}
+		}
+	}
+
+	printf("{\"offscreen\": \"software\", \"frames\": %zu, \"frame_avg_ms\": %.4f, \"frame_p50_ms\": %.4f, \"frame_p99_ms\": %.4f, \"frame_max_ms\": %.4f, "
+		"\"golden_compared\": %d, \"golden_different\": %d, \"first_different\": %d}\n",
+		count, count > 0 ? total * 1000.0 / count : 0.0,
+		count > 0 ? sorted[count / 2] * 1000.0 : 0.0, count > 0 ? sorted[(count * 99) / 100] * 1000.0 : 0.0,
+		count > 0 ? sorted.back() * 1000.0 : 0.0, compared, different, firstDifferent);
+	return different == 0;
+}
+
+//Shows what was drawn and closes the frame
+void presentFrame()
+{
+#ifdef BRICK_PROFILE
+	renderProfileOverlay();
+#endif
+
+	{
+		PROFILE_SCOPE(PROFILE_PRESENT);
+		SDL_RenderPresent(gRenderer);
+	}
+	if (gOffscreenSurface != NULL)
+		captureFrame();
+	endFrame();
+
+#ifdef BRICK_PROFILE
+	Profiler::get().endFrame();
+#endif
+}
+
+//Shows one of the screens that is nothing but text until the game moves
+// on from it. Nothing changes on them until a key is pressed, so they are
+// drawn once and then sleep in the event queue, and only drawn again after
+// input or when the window lost what was on it.
+void runTextScreen(Game& local, Player& player, LText& text, const std::string& message)
+{
+	const Game& game = playedGame(local);
+	GAMEMODE mode = game.getState().mode;
+	SDL_Event e;
+
+	//A replay or the autopilot has steps to play without any input, and
+	// a versus game has the other end's, so they step every tick, or
+	// straight away when uncapped. Otherwise the loader is only checked on
+	// now and then. Both happen when they are due on the clock, however many
+	// events keep coming in between.
+	bool scripted = gReplayPath != NULL || gAutopilot != NULL || gVersus != NULL;
+	Uint64 frequency = SDL_GetPerformanceFrequency();
+	Uint64 period = frequency * IDLE_WAIT_MS / 1000;
+	if (scripted)
+		period = gUncapped ? 0 : (Uint64)(game.getTickLength() * frequency);
+	Uint64 due = SDL_GetPerformanceCounter() + period;
+
+	//The text never changes while the screen is up
+	text.setText(message);
+
+	bool redraw = true;
+	while (game.getState().mode == mode && isRunning)
+	{
+		if (redraw)
+		{
+			//Clear screen
+			SDL_SetRenderDrawColor(gRenderer, 0x00, 0x00, 0x00, 0xFF);
+			SDL_RenderClear(gRenderer);
+
+			//Render text
+			{
+				PROFILE_SCOPE(PROFILE_TEXT);
+				text.render(((SCREEN_WIDTH - text.getWidth()) / 2), (SCREEN_HEIGHT - text.getHeight()) / 3);
+			}
+
+			presentFrame();
+			redraw = false;
+		}
+
+		Uint64 now = SDL_GetPerformanceCounter();
+		if (now >= due)
+		{
+			//Pick up the assets as soon as the loader has them
+			if (!finishLoading(false))
+				isRunning = false;
+			if (scripted)
+			{
+				stepGame(local, player);
+				redraw = true;
+			}
+
+			//Keep to the tick, but don't race to catch up after a long stall
+			due = now - due >= period ? now + period : due + period;
+
+			//Draw the step before sleeping, uncapped it is drawn after a look at the events
+			if ((redraw && period > 0) || game.getState().mode != mode || !isRunning)
+				continue;
+			now = SDL_GetPerformanceCounter();
+		}
+
+		//Sleep until something happens or the next step is due
+		Uint32 waitMs = now >= due ? 0 : (Uint32)(((due - now) * 1000 + frequency - 1) / frequency);
+		bool gotEvent;
+		{
+			PROFILE_SCOPE(PROFILE_EVENTS);
+			gotEvent = SDL_WaitEventTimeout(&e, waitMs) != 0;
+		}
+		if (!gotEvent)
+			continue;
+
+		//Handle everything that woke us up, until the next step is due
+		do
+		{
+			//User requests quit
+			if (e.type == SDL_QUIT)
+				isRunning = false;
+			//The window has to be drawn again
+			else if (e.type == SDL_WINDOWEVENT)
+			{
+				if (e.window.event == SDL_WINDOWEVENT_EXPOSED || e.window.event == SDL_WINDOWEVENT_SIZE_CHANGED ||
+					e.window.event == SDL_WINDOWEVENT_RESTORED)
+					redraw = true;
+			}
+			//The renderer threw away what was drawn into textures
+			else if (e.type == SDL_RENDER_TARGETS_RESET)
+			{
+				gBrickLayer.invalidate();
+				redraw = true;
+			}
+			//The renderer lost every texture
+			else if (e.type == SDL_RENDER_DEVICE_RESET)
+			{
+				gBrickLayer.create(SCREEN_WIDTH, SCREEN_HEIGHT);
+				redraw = true;
+			}
+			//Keys for the developer tools
+			handleDebugKeys(e);
+			//Handle input for the player
+			player.handleEvent(e);
+
+			//Every key gets its own step, so a press and release that
+			// arrive together still count as a press. Space moves on.
+			if (e.type == SDL_KEYDOWN || e.type == SDL_KEYUP)
+			{
+				stepGame(local, player);
+				redraw = true;
+			}
+		} while (game.getState().mode == mode && isRunning && SDL_GetPerformanceCounter() < due && SDL_PollEvent(&e) != 0);
+	}
+}
+
 void run()
 {
 	//Start up SDL and create window
@@ -775,335 +2071,427 @@ void run()
 			//Event handler
 			SDL_Event e;
 
+			//The rules of the game, the frontend only feeds it input and draws it
+			Game local(gConfig);
+			const Game& game = playedGame(local);
+			const double tickLength = game.getTickLength();
+
 			//The Player that will be moving around on the screen
 			Player player;
 
-			Enemy darthVader(100, 80);
-			Enemy stormTrooper(165, 80);
-			Enemy bobaFett(230, 80);
-			Enemy lukeSkywalker(295, 80);
-			Enemy yodaYoda(360, 80);
-			Enemy obiWan(425, 80);
-			Enemy hanSolo(490, 80);
-			Enemy deathStar(555, 80);
-			Enemy darthVader2(100, 120);
-			Enemy stormTrooper2(165, 120);
-			Enemy bobaFett2(230, 120);
-			Enemy lukeSkywalker2(295, 120);
-			Enemy yodaYoda2(360, 120);
-			Enemy obiWan2(425, 120);
-			Enemy hanSolo2(490, 120);
-			Enemy deathStar2(555, 120);
-			Enemy darthVader3(100, 160);
-			Enemy stormTrooper3(165, 160);
-			Enemy bobaFett3(230, 160);
-			Enemy lukeSkywalker3(295, 160);
-			Enemy yodaYoda3(360, 160);
-			Enemy obiWan3(425, 160);
-			Enemy hanSolo3(490, 160);
-			Enemy deathStar3(555, 160);
-
-			int ballX = SCREEN_WIDTH / 2;
-			int ballY = SCREEN_HEIGHT / 2;
-			int ballYDir = +3;
-			int ballXDir = +3;
-
-			//If there is no music playing
-			if (Mix_PlayingMusic() == 0)
-				Mix_PlayMusic(gMusic, -1);//Play the music
+			//Every step of play is saved to go back to. Going back would
+			// break a recording or a replay, and the other end of a versus
+			// game can't be made to go back with us.
+			bool rewindEnabled = gRewindMb > 0 && gRecordPath == NULL && gReplayPath == NULL && gVersus == NULL;
+			RewindBuffer rewind(gConfig.tickRate, RewindBuffer::DEFAULT_SECONDS, rewindEnabled ? (size_t)gRewindMb * 1024 * 1024 : 0);
+			bool rewindHeld = false;
+
+			//Start recording from the first step
+			if (gRecordPath != NULL)
+				gReplay.begin(gConfig, gLevelPath);
+
+			//Offscreen frames have to come out the same every run, so they
+			// can't depend on when the loader finishes
+			if (gOffscreenSurface != NULL)
+			{
+				if (!finishLoading(true))
+					isRunning = false;
+				gOffscreenFrameStart = SDL_GetPerformanceCounter();
+			}
 
 			//While application is running
 			while (isRunning == true)
 			{
-				switch (GameState)
+				switch (game.getState().mode)
 				{
 				case GAMEMODE::PLAY:
-					
-					ballX = SCREEN_WIDTH / 2;
-					ballY = SCREEN_HEIGHT / 2;
-					ballYDir = +3;
-					ballXDir = +3;
-
-					darthVader.reset(100, 80);
-					stormTrooper.reset(165, 80);
-					bobaFett.reset(230, 80);
-					lukeSkywalker.reset(295, 80);
-					yodaYoda.reset(360, 80);
-					obiWan.reset(425, 80);
-					hanSolo.reset(490, 80);
-					deathStar.reset(555, 80);
-					darthVader2.reset(100, 120);
-					stormTrooper2.reset(165, 120);
-					bobaFett2.reset(230, 120);
-					lukeSkywalker2.reset(295, 120);
-					yodaYoda2.reset(360, 120);
-					obiWan2.reset(425, 120);
-					hanSolo2.reset(490, 120);
-					deathStar2.reset(555, 120);
-					darthVader3.reset(100, 160);
-					stormTrooper3.reset(165, 160);
-					bobaFett3.reset(230, 160);
-					lukeSkywalker3.reset(295, 160);
-					yodaYoda3.reset(360, 160);
-					obiWan3.reset(425, 160);
-					hanSolo3.reset(490, 160);
-					deathStar3.reset(555, 160);
-
-					while (GameState == GAMEMODE::PLAY)
+				{
+					//The paddle and the sounds have to be there to play
+					if (!finishLoading(true))
 					{
-						//Handle events on queue			
-						while (SDL_PollEvent(&e) != 0)
-						{
-							//User requests quit
-							if (e.type == SDL_QUIT)
-							{
-								isRunning = false;
-								GameState = GAMEMODE::EXIT;
-							}
-							//Handle input for the player
-							player.handleEvent(e);
-						}
-
-						//Move the Player
-						player.move();
-
-						//Clear screen
-						SDL_SetRenderDrawColor(gRenderer, 0x00, 0x00, 0x00, 0xFF);
-						SDL_RenderClear(gRenderer);
-
-						SDL_Rect ballRect = { ballX, ballY, 20, 20 };
-						SDL_SetRenderDrawColor(gRenderer, 0xFF, 0xFF, 0xFF, 0xFF);
-						SDL_RenderFillRect(gRenderer, &ballRect);
-						
-						darthVader.render(ballRect, player, ballXDir, ballYDir, ballRect); darthVader.move();
-						stormTrooper.render(ballRect, player, ballXDir, ballYDir, ballRect); stormTrooper.move();
-						bobaFett.render(ballRect, player, ballXDir, ballYDir, ballRect); bobaFett.move();
-						lukeSkywalker.render(ballRect, player, ballXDir, ballYDir, ballRect); lukeSkywalker.move();
-						yodaYoda.render(ballRect, player, ballXDir, ballYDir, ballRect); yodaYoda.move();
-						obiWan.render(ballRect, player, ballXDir, ballYDir, ballRect); obiWan.move();
-						hanSolo.render(ballRect, player, ballXDir, ballYDir, ballRect); hanSolo.move();
-						deathStar.render(ballRect, player, ballXDir, ballYDir, ballRect); deathStar.move();
-
-						darthVader2.render(ballRect, player, ballXDir, ballYDir, ballRect) ;darthVader2.move();
-						stormTrooper2.render(ballRect, player, ballXDir, ballYDir, ballRect); stormTrooper2.move();
-						bobaFett2.render(ballRect, player, ballXDir, ballYDir, ballRect); bobaFett2.move();
-						lukeSkywalker2.render(ballRect, player, ballXDir, ballYDir, ballRect); lukeSkywalker2.move();
-						yodaYoda2.render(ballRect, player, ballXDir, ballYDir, ballRect); yodaYoda2.move();
-						obiWan2.render(ballRect, player, ballXDir, ballYDir, ballRect); obiWan2.move();
-						hanSolo2.render(ballRect, player, ballXDir, ballYDir, ballRect); hanSolo2.move();
-						deathStar2.render(ballRect, player, ballXDir, ballYDir, ballRect); deathStar2.move();
-
-						darthVader3.render(ballRect, player, ballXDir, ballYDir, ballRect); darthVader3.move();
-						stormTrooper3.render(ballRect, player, ballXDir, ballYDir, ballRect); stormTrooper3.move();
-						bobaFett3.render(ballRect, player, ballXDir, ballYDir, ballRect); bobaFett3.move();
-						lukeSkywalker3.render(ballRect, player, ballXDir, ballYDir, ballRect); lukeSkywalker3.move();
-						yodaYoda3.render(ballRect, player, ballXDir, ballYDir, ballRect); yodaYoda3.move();
-						obiWan3.render(ballRect, player, ballXDir, ballYDir, ballRect); obiWan3.move();
-						hanSolo3.render(ballRect, player, ballXDir, ballYDir, ballRect); hanSolo3.move();
-						deathStar3.render(ballRect, player, ballXDir, ballYDir, ballRect); deathStar3.move();
-						
-						//Render objects
-						player.render();
-
-						//Ball stuff| it should be a class but im lazy
-						ballX += ballXDir;
-						ballY += ballYDir;
-
-						if (ballX <= 0){
-							Mix_PlayChannel(-1, gBounce, 0);
-							ballXDir = +3;
-						}
-						if (ballX >= 780){
-							Mix_PlayChannel(-1, gBounce, 0);
-							ballXDir = -3;
-						}
-						if (ballY <= 0){
-							Mix_PlayChannel(-1, gBounce, 0);
-							ballYDir = +3;
-						}
-						if (ballY >= 580){
-							ballYDir = -3;
-							GameState = GAMEMODE::SCORE;
-						}
-						if (checkCollision(ballRect, player.pColliderMid) && ballYDir == +3){
-							Mix_PlayChannel(-1, gBounce, 0);
-							ballYDir = -3;
-						}
-						if (checkCollision(ballRect, player.pColliderLeft) && ballYDir == +3){
-							Mix_PlayChannel(-1, gBounce, 0);
-							ballYDir = -3;
-							if (ballXDir == +3)
-								ballXDir = -3;
-						}
-						if (checkCollision(ballRect, player.pColliderRight) && ballYDir == +3){
-							Mix_PlayChannel(-1, gBounce, 0);
-							ballYDir = -3;
-							if (ballXDir == -3)
-								ballXDir = +3;
-						}
+						isRunning = false;
+						break;
+					}
 
-						//Open the font
-						gFont = TTF_OpenFont("04B_19__.ttf", 28);
-						if (gFont == NULL)
-							printf("Failed to load lazy font! SDL_ttf Error: %s\n", TTF_GetError());
-						else
-						{
-							//Render text
-							SDL_Color textColor = { 255, 255, 255 };
-							if (!gTextTexture.loadFromRenderedText(player.textScore, textColor))
-								printf("Failed to render text texture!\n");
-						}
+					//A new game started, so the layer has every brick back
+					gBrickLayer.invalidate();
+					gParticles.clear();
 
-						//Render current frame
-						gTextTexture.render((SCREEN_WIDTH - gTextTexture.getWidth()), (SCREEN_HEIGHT - gTextTexture.getHeight()));
+					//Rewind goes back as far as the start of this game
+					rewind.clear();
+					if (rewindEnabled)
+						rewind.record(game);
 
-						SDL_RenderPresent(gRenderer);
+					//Real time that still has to be simulated
+					double accumulator = 0.0;
+					Uint64 lastCounter = SDL_GetPerformanceCounter();
+					const double counterFrequency = (double)SDL_GetPerformanceFrequency();
 
-						if (player.score == 2400)
-							GameState = GAMEMODE::WIN;
+					//Rollbacks the brick layer has been drawn again after
+					uint64_t drawnRollbacks = gVersus != NULL ? gVersus->getSession().getStats().rollbacks : 0;
 
-					}
-					break;
-				case GAMEMODE::MENU:
-					//reseting the player's score
-					player.score = 0;
-					player.textScore = std::to_string(player.score);
-
-					while (GameState == GAMEMODE::MENU)
+					while (game.getState().mode == GAMEMODE::PLAY && isRunning)
 					{
 						//Handle events on queue
-						while (SDL_PollEvent(&e) != 0)
 						{
-							//User requests quit
-							if (e.type == SDL_QUIT)
+							PROFILE_SCOPE(PROFILE_EVENTS);
+							while (SDL_PollEvent(&e) != 0)
 							{
-								isRunning = false;
-								GameState = GAMEMODE::EXIT;
+								//User requests quit
+								if (e.type == SDL_QUIT)
+									isRunning = false;
+								//The renderer threw away what was drawn into textures
+								else if (e.type == SDL_RENDER_TARGETS_RESET)
+									gBrickLayer.invalidate();
+								//The renderer lost every texture
+								else if (e.type == SDL_RENDER_DEVICE_RESET)
+									gBrickLayer.create(SCREEN_WIDTH, SCREEN_HEIGHT);
+								//Keys for the developer tools
+								handleDebugKeys(e);
+								//Backspace is held to rewind
+								if ((e.type == SDL_KEYDOWN || e.type == SDL_KEYUP) && e.key.keysym.sym == SDLK_BACKSPACE)
+									rewindHeld = e.type == SDL_KEYDOWN;
+								//Handle input for the player
+								player.handleEvent(e);
 							}
-							//Handle input for the player
-							player.handleEvent(e);
 						}
 
-						//Clear screen
-						SDL_SetRenderDrawColor(gRenderer, 0x00, 0x00, 0x00, 0xFF);
-						SDL_RenderClear(gRenderer);
-
-						//Open the font
-						gFont = TTF_OpenFont("04B_19__.ttf", 28);
-						if (gFont == NULL)
-							printf("Failed to load lazy font! SDL_ttf Error: %s\n", TTF_GetError());
-						else
+						//How much time passed since the last frame
+						Uint64 counter = SDL_GetPerformanceCounter();
+						double frameTime = (counter - lastCounter) / counterFrequency;
+						lastCounter = counter;
+						if (frameTime > MAX_FRAME_TIME)
+							frameTime = MAX_FRAME_TIME;
+						//Uncapped, every frame is exactly one step however long it took
+						if (gUncapped)
+							frameTime = tickLength;
+						accumulator += frameTime;
+
+						//Move everything along in fixed steps, however fast the display is
 						{
-							//Render text
-							SDL_Color textColor = { 255, 255, 255 };
-							if (!gTextTexture.loadFromRenderedText("Brick Breaker:\n\n\nPress Space", textColor))
-								printf("Failed to render text texture!\n");
-						}
-
-						//Render current frame
-						gTextTexture.render( ((SCREEN_WIDTH - gTextTexture.getWidth()) / 2), (SCREEN_HEIGHT - gTextTexture.getHeight()) / 3);
-
-						SDL_RenderPresent(gRenderer);
-					}
-					break;
-				case GAMEMODE::SCORE:
-					while (GameState == GAMEMODE::SCORE)
-					{
-						//Handle events on queue
-						while (SDL_PollEvent(&e) != 0)
-						{
-							//User requests quit
-							if (e.type == SDL_QUIT)
+							PROFILE_SCOPE(PROFILE_STEP);
+							bool rewound = false;
+							while (accumulator >= tickLength && game.getState().mode == GAMEMODE::PLAY)
 							{
-								isRunning = false;
-								GameState = GAMEMODE::EXIT;
+								//Back one saved step for every step, until the oldest one
+								if (rewindHeld && rewindEnabled)
+									rewound |= rewind.rewind(local);
+								//A versus step waiting on the peer leaves the last step's events behind
+								else if (stepGame(local, player))
+								{
+									if (rewindEnabled)
+										rewind.record(game);
+									queueSounds(game.getEvents());
+									eraseBricks(game.getEvents(), game.getState().bricks);
+									spawnDebris(game.getEvents(), game.getState().bricks);
+								}
+								gParticles.update((float)tickLength);
+								accumulator -= tickLength;
 							}
-							//Handle input for the player
-							player.handleEvent(e);
+
+							//Bricks came back, which the layer only hears about from events
+							if (rewound)
+								gBrickLayer.invalidate();
 						}
 
-						//Clear screen
-						SDL_SetRenderDrawColor(gRenderer, 0x00, 0x00, 0x00, 0xFF);
-						SDL_RenderClear(gRenderer);
+						//A rollback played steps again without handing out their events,
+						// so the layer can't know which bricks came and went
+						if (gVersus != NULL && gVersus->getSession().getStats().rollbacks != drawnRollbacks)
+						{
+							drawnRollbacks = gVersus->getSession().getStats().rollbacks;
+							gBrickLayer.invalidate();
+						}
 
-						//Open the font
-						gFont = TTF_OpenFont("04B_19__.ttf", 28);
-						if (gFont == NULL)
-							printf("Failed to load lazy font! SDL_ttf Error: %s\n", TTF_GetError());
-						else
+						//Everything the steps of this frame asked for, played at most once per sample
 						{
-							//Render text
-							SDL_Color textColor = { 255, 255, 255 };
-							if (!gTextTexture.loadFromRenderedText("Final Score: " + player.textScore + "\n\n\n\n\nPress Space", textColor))
-								printf("Failed to render text texture!\n");
+							PROFILE_SCOPE(PROFILE_SOUND);
+							gSounds.dispatch();
 						}
 
-						//Render current frame
-						gTextTexture.render(((SCREEN_WIDTH - gTextTexture.getWidth()) / 2), (SCREEN_HEIGHT - gTextTexture.getHeight()) / 3);
+						const GameState& state = game.getState();
+						if (state.players > 1)
+							player.setScores(state.score, state.score2);
+						else
+							player.setScore(state.score);
 
-						SDL_RenderPresent(gRenderer);
+						//Draw the part of the way to the next step that has already passed
+						float alpha = (float)(accumulator / tickLength);
 
-					}
-					break;
-				case GAMEMODE::WIN:
-					while (GameState == GAMEMODE::WIN)
-					{
-						//Handle events on queue
-						while (SDL_PollEvent(&e) != 0)
+						//Clear screen and render objects
 						{
-							//User requests quit
-							if (e.type == SDL_QUIT)
-							{
-								isRunning = false;
-								GameState = GAMEMODE::EXIT;
-							}
-							//Handle input for the player
-							player.handleEvent(e);
+							PROFILE_SCOPE(PROFILE_DRAW);
+							SDL_SetRenderDrawColor(gRenderer, 0x00, 0x00, 0x00, 0xFF);
+							SDL_RenderClear(gRenderer);
+							renderPlay(state, alpha);
+							player.render(state.paddle, alpha);
+							if (state.players > 1)
+								player.render(state.paddle2, alpha);
 						}
 
-						//Clear screen
-						SDL_SetRenderDrawColor(gRenderer, 0x00, 0x00, 0x00, 0xFF);
-						SDL_RenderClear(gRenderer);
-
-						//Open the font
-						gFont = TTF_OpenFont("04B_19__.ttf", 28);
-						if (gFont == NULL)
-							printf("Failed to load lazy font! SDL_ttf Error: %s\n", TTF_GetError());
-						else
+						//Render text, only laid out again when the score changed
 						{
-							//Render text
-							SDL_Color textColor = { 255, 255, 255 };
-							if (!gTextTexture.loadFromRenderedText("You Win!\n\n\n\n\nPress Space", textColor))
-								printf("Failed to render text texture!\n");
+							PROFILE_SCOPE(PROFILE_TEXT);
+							gScoreText.setText(player.textScore);
+							gScoreText.render((SCREEN_WIDTH - gScoreText.getWidth()), (SCREEN_HEIGHT - gScoreText.getHeight()));
 						}
 
-						//Render current frame
-						gTextTexture.render(((SCREEN_WIDTH - gTextTexture.getWidth()) / 2), (SCREEN_HEIGHT - gTextTexture.getHeight()) / 3);
-
-						SDL_RenderPresent(gRenderer);
+						presentFrame();
 
+						//Without vsync, sleep off whatever is left of this step
+						if (!gVsync && !gUncapped)
+						{
+							double busy = (SDL_GetPerformanceCounter() - lastCounter) / counterFrequency;
+							if (busy < tickLength)
+								SDL_Delay((Uint32)((tickLength - busy) * 1000.0));
+						}
 					}
 					break;
+				}
+				case GAMEMODE::MENU:
+					runTextScreen(local, player, gMenuText, "Brick Breaker:\n\n\nPress Space");
+					break;
+				case GAMEMODE::SCORE:
+					runTextScreen(local, player, gFinalScoreText, "Final Score: " + player.textScore + "\n\n\n\n\nPress Space");
+					break;
+				case GAMEMODE::WIN:
+				{
+					//In a versus game the bricks ran out, whoever got more of them won
+					std::string message = "You Win!";
+					const GameState& state = game.getState();
+					if (state.players > 1)
+						message = state.score == state.score2 ? "A Draw!" : (state.score > state.score2 ? "Player 1 Wins!" : "Player 2 Wins!");
+					runTextScreen(local, player, gWinText, message + "\n\n\n\n\nPress Space");
+					break;
+				}
 				default:
 					break;
 				}
 				
 			}
+
+			//Save the keys along with how the game stood when the session ended
+			if (gRecordPath != NULL)
+			{
+				gReplay.finish(game.getState());
+				if (gReplay.save(gRecordPath))
+					printf("Recorded %u steps to %s\n", gReplay.stepCount, gRecordPath);
+			}
+
+			//What saving every step cost
+			const RewindStats& rewindStats = rewind.getStats();
+			if (rewindStats.recorded > 0)
+				printf("Rewind: %llu steps saved, %.2f us each on average and %.2f us at most, %.0f bytes a step of %.0f, %.1f s held in %zu MB\n",
+					(unsigned long long)rewindStats.recorded, rewindStats.recordMs * 1000.0 / rewindStats.recorded, rewindStats.maxRecordMs * 1000.0,
+					(double)rewindStats.storedBytes / rewindStats.recorded, (double)rewindStats.rawBytes / rewindStats.recorded,
+					rewind.getSeconds(), rewind.getBudget() / (1024 * 1024));
 		}
 	}
 
+	gSounds.report(gDroppedSounds);
+
+	size_t resident = getResidentBytes();
+	if (resident > 0)
+		printf("Memory: resident %.1f MB at the end of the session\n", resident / 1048576.0);
+
 	std::cout << "Closing down the window! T-2sec" << std::endl;
 }
 
 int main(int argc, char* args[])
 {
-	run(); // Play the game
+	//Start up time is counted from here
+	gStartCounter = SDL_GetPerformanceCounter();
+
+	//A versus game: the port to listen on, the other end and which player this is
+	int versusPort = 0;
+	std::string versusHost;
+	int versusPeerPort = 0;
+	int versusPlayer = 1;
+	int versusDelay = 2;
+	LinkImpairment impairment;
+
+	//Read the command line options
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = args[i];
+		if (arg == "--tick-rate" && i + 1 < argc)
+			gConfig.tickRate = atoi(args[++i]);
+		else if (arg == "--balls" && i + 1 < argc)
+			gConfig.ballCount = atoi(args[++i]);
+		else if (arg == "--seed" && i + 1 < argc)
+			gConfig.seed = (unsigned int)strtoul(args[++i], NULL, 10);
+		else if (arg == "--level" && i + 1 < argc)
+		{
+			//Fall back to the classic bricks if the level can't be used
+			if (gLevel.open(args[++i]))
+			{
+				gConfig.layout = &gLevel.getLayout();
+				gLevelPath = args[i];
+			}
+			else
+				printf("Failed to load level %s, playing the classic level\n", args[i]);
+		}
+		else if (arg == "--profile-csv" && i + 1 < argc)
+		{
+#ifdef BRICK_PROFILE
+			Profiler::get().openCsv(args[++i]);
+#else
+			printf("--profile-csv needs a build with BRICK_PROFILE defined\n");
+			i++;
+#endif
+		}
+		else if (arg == "--record" && i + 1 < argc)
+			gRecordPath = args[++i];
+		else if (arg == "--replay" && i + 1 < argc)
+			gReplayPath = args[++i];
+		else if (arg == "--autoplay")
+			gAutoplay = true;
+		else if (arg == "--uncapped")
+			gUncapped = true;
+		else if (arg == "--offscreen" && i + 1 < argc)
+			gOffscreenFrames = atoi(args[++i]);
+		else if (arg == "--dump-frames" && i + 1 < argc)
+			gDumpDir = args[++i];
+		else if (arg == "--frame-hashes" && i + 1 < argc)
+			gHashPath = args[++i];
+		else if (arg == "--golden" && i + 1 < argc)
+			gGoldenPath = args[++i];
+		else if (arg == "--debris" && i + 1 < argc)
+			gDebrisPerBrick = atoi(args[++i]);
+		else if (arg == "--draw-stats")
+			gDrawStatsEnabled = true;
+		else if (arg == "--unbatched-bricks")
+			gUnbatchedBricks = true;
+		else if (arg == "--rewind-mb" && i + 1 < argc)
+			gRewindMb = atoi(args[++i]);
+		else if (arg == "--versus" && i + 2 < argc)
+		{
+			versusPort = atoi(args[++i]);
+			std::string peer = args[++i];
+			size_t colon = peer.rfind(':');
+			if (colon != std::string::npos)
+			{
+				versusHost = peer.substr(0, colon);
+				versusPeerPort = atoi(peer.c_str() + colon + 1);
+			}
+		}
+		else if (arg == "--player" && i + 1 < argc)
+			versusPlayer = atoi(args[++i]);
+		else if (arg == "--input-delay" && i + 1 < argc)
+			versusDelay = atoi(args[++i]);
+		else if (arg == "--latency" && i + 1 < argc)
+			impairment.latencyMs = atof(args[++i]);
+		else if (arg == "--jitter" && i + 1 < argc)
+			impairment.jitterMs = atof(args[++i]);
+		else if (arg == "--loss" && i + 1 < argc)
+			impairment.loss = (float)atof(args[++i]);
+		else
+			printf("Unknown option %s\n", args[i]);
+	}
+	if (gConfig.tickRate <= 0)
+		gConfig.tickRate = DEFAULT_TICK_RATE;
+	if (gConfig.ballCount <= 0)
+		gConfig.ballCount = 1;
+
+	//A replay brings its own set up, and has to be played on the bricks it was recorded on
+	if (gReplayPath != NULL)
+	{
+		if (gRecordPath != NULL)
+		{
+			printf("--record and --replay can't be used together\n");
+			return 1;
+		}
+		if (!gReplay.load(gReplayPath))
+			return 1;
+		gReplay.applyTo(gConfig);
+		if (gLevelPath.empty() && !gReplay.level.empty())
+		{
+			if (!gLevel.open(gReplay.level.c_str()))
+				return 1;
+			gConfig.layout = &gLevel.getLayout();
+			gLevelPath = gReplay.level;
+		}
+		if (hashLayout(gConfig.layout != NULL ? *gConfig.layout : classicLayout()) != gReplay.layoutHash)
+		{
+			printf("The replay was recorded on different bricks\n");
+			return 1;
+		}
+	}
+
+	//A versus game plays in real time on keys from both ends, nothing can
+	// be recorded into or played from a one player replay
+	if (versusPort > 0)
+	{
+		if (versusPeerPort <= 0 || (versusPlayer != 1 && versusPlayer != 2))
+		{
+			printf("--versus needs a port and the other end as host:port, and --player has to be 1 or 2\n");
+			return 1;
+		}
+		if (gRecordPath != NULL || gReplayPath != NULL || gOffscreenFrames > 0 || gUncapped)
+		{
+			printf("--versus can't be used with --record, --replay, --offscreen or --uncapped\n");
+			return 1;
+		}
+		gConfig.players = 2;
+	}
 
-	SDL_Delay(2000);
+	//Offscreen frames are one step each, played by the autopilot or a replay
+	if (gOffscreenFrames > 0)
+	{
+		gUncapped = true;
+		if (gReplayPath == NULL)
+			gAutoplay = true;
+	}
+
+	//The autopilot plays with the game's seed, and gives up on a game
+	// after ten minutes of play so a session keeps cycling
+	AutopilotConfig autopilotConfig;
+	autopilotConfig.seed = gConfig.seed;
+	autopilotConfig.giveUpAfter = 10 * 60 * gConfig.tickRate;
+	autopilotConfig.player = versusPlayer - 1;
+	Autopilot autopilot(autopilotConfig);
+	if (gAutoplay)
+	{
+		gAutopilot = &autopilot;
+		gSoak.start();
+	}
+
+	if (versusPort > 0)
+	{
+		//Each end drops its own packets with its own luck
+		VersusPeer versus(gConfig, versusPlayer - 1, versusDelay);
+		if (!versus.open(versusPort, versusHost.c_str(), versusPeerPort))
+			return 1;
+		impairment.seed = gConfig.seed * 2 + versusPlayer;
+		versus.setImpairment(impairment);
+		gVersus = &versus;
+
+		run(); // Play the game against the other end
+
+		const RollbackStats& rollback = versus.getSession().getStats();
+		printf("Versus: %llu steps, %llu rollbacks up to %d steps deep, longest took %.3f ms, %llu stalls, %llu desyncs\n",
+			(unsigned long long)rollback.steps, (unsigned long long)rollback.rollbacks, rollback.maxDepth, rollback.maxResimulateMs,
+			(unsigned long long)rollback.stalls, (unsigned long long)versus.getStats().desyncs);
+		gVersus = NULL;
+	}
+	else
+		run(); // Play the game
+
+	if (gAutopilot != NULL)
+	{
+		gSoak.finish(stdout);
+		gAutopilot = NULL;
+	}
+
+	//Nobody is watching an offscreen session close
+	bool framesMatch = true;
+	if (gOffscreenFrames > 0)
+		framesMatch = reportOffscreen();
+	else
+		SDL_Delay(2000);
 
 	Mix_HaltMusic();//Stop the music
 
 	close();//Free the resources and close SDL
 
-	return 0;
+	return framesMatch ? 0 : 2;
 }
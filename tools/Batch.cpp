@@ -0,0 +1,312 @@
+/*
+PROGRAM: Brick Breakers Using SDL
+PART: Parallel batch runner. Plays thousands of independent headless
+      games of one level, one per seed, across every core, and prints
+      one JSON object with how they went: clear rate, steps to clear,
+      bounces and score. Each game has its own Game and input, the only
+      thing they share is the read only layout, so the results don't
+      depend on the thread count.
+
+      The autopilot never gives up, so a lost game is one it really
+      lost. A game where no brick has gone for --stuck-after seconds of
+      play is stopped and counted as stuck, the ball is going round the
+      same path, rather than played out to the step limit.
+
+      g++ -O2 -pthread -I.. Batch.cpp ../core/[A-Z]*.cpp -o batch
+      ./batch --level big.lvl --seeds 1-10000 [--replay game.rep] [--threads N] [--stuck-after S]
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "core/Autopilot.h"
+#include "core/Game.h"
+#include "core/Hash.h"
+#include "core/LevelFile.h"
+#include "core/Replay.h"
+
+//How one game ended
+enum class OUTCOME{
+	CLEARED,
+	LOST,
+
+	//Ran out of steps, or out of recorded keys
+	UNFINISHED,
+
+	//Went on too long without a brick going
+	STUCK
+};
+
+//What one game came to, filled in by whichever thread played it
+struct GameResult
+{
+	unsigned int seed;
+	OUTCOME outcome;
+
+	//Steps from the first of play to the end of the game
+	unsigned int playSteps;
+
+	unsigned int bounces;
+	int score;
+	int bricksLeft;
+};
+
+//Everything every game is played with
+struct BatchConfig
+{
+	GameConfig game;
+	AutopilotConfig autopilot;
+
+	//Played in place of the autopilot if there is one
+	const Replay* replay = NULL;
+
+	//Steps a game may last, menu included, before it counts as unfinished
+	unsigned int maxSteps = 0;
+
+	//Steps of play without a brick destroyed before a game counts as stuck
+	unsigned int stuckSteps = 0;
+};
+
+//Plays one game from the menu to its end screen
+static GameResult playGame(const BatchConfig& batch, unsigned int seed)
+{
+	GameConfig config = batch.game;
+	config.seed = seed;
+	Game game(config);
+
+	AutopilotConfig pilotConfig = batch.autopilot;
+	pilotConfig.seed = seed;
+	Autopilot autopilot(pilotConfig);
+
+	Replay empty;
+	ReplayCursor cursor(batch.replay != NULL ? *batch.replay : empty);
+
+	GameResult result = { seed, OUTCOME::UNFINISHED, 0, 0, 0, 0 };
+	bool played = false;
+	unsigned int sinceBrick = 0;
+	for (unsigned int step = 0; step < batch.maxSteps; step++)
+	{
+		const GameState& state = game.getState();
+		if (state.mode == GAMEMODE::PLAY)
+		{
+			played = true;
+			result.playSteps++;
+			if (++sinceBrick > batch.stuckSteps)
+			{
+				result.outcome = OUTCOME::STUCK;
+				break;
+			}
+		}
+		else if (played)
+		{
+			result.outcome = state.mode == GAMEMODE::WIN ? OUTCOME::CLEARED : OUTCOME::LOST;
+			break;
+		}
+
+		Input input;
+		if (batch.replay == NULL)
+			input = autopilot.next(state);
+		else if (!cursor.next(input))
+			break;
+		game.step(input);
+
+		const std::vector<GameEvent>& events = game.getEvents();
+		for (size_t i = 0; i < events.size(); i++)
+		{
+			if (events[i].type == EVENT::BOUNCE)
+				result.bounces++;
+			else if (events[i].type == EVENT::BRICK_DESTROYED)
+				sinceBrick = 0;
+		}
+	}
+
+	result.score = game.getState().score;
+	result.bricksLeft = game.getState().bricks.getAliveCount();
+	return result;
+}
+
+//Reads "first-last" or a single seed
+static bool readSeeds(const char* text, unsigned int& first, unsigned int& last)
+{
+	char* end;
+	first = (unsigned int)strtoul(text, &end, 10);
+	if (end == text)
+		return false;
+	last = first;
+	if (*end == '-')
+	{
+		const char* rest = end + 1;
+		last = (unsigned int)strtoul(rest, &end, 10);
+		if (end == rest)
+			return false;
+	}
+	return *end == '\0' && last >= first;
+}
+
+//The value at fraction p of the way through sorted values
+static unsigned int percentile(const std::vector<unsigned int>& sorted, double p)
+{
+	if (sorted.empty())
+		return 0;
+	size_t index = (size_t)(p * (sorted.size() - 1) + 0.5);
+	return sorted[index];
+}
+
+int main(int argc, char* args[])
+{
+	const char* levelPath = NULL;
+	const char* replayPath = NULL;
+	unsigned int firstSeed = 1, lastSeed = 1000;
+	int threadCount = (int)std::thread::hardware_concurrency();
+	bool perGame = false;
+	BatchConfig batch;
+	double maxMinutes = 10.0;
+	double stuckSeconds = 120.0;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(args[i], "--level") == 0 && i + 1 < argc)
+			levelPath = args[++i];
+		else if (strcmp(args[i], "--replay") == 0 && i + 1 < argc)
+			replayPath = args[++i];
+		else if (strcmp(args[i], "--seeds") == 0 && i + 1 < argc && readSeeds(args[i + 1], firstSeed, lastSeed))
+			i++;
+		else if (strcmp(args[i], "--threads") == 0 && i + 1 < argc)
+			threadCount = atoi(args[++i]);
+		else if (strcmp(args[i], "--balls") == 0 && i + 1 < argc)
+			batch.game.ballCount = atoi(args[++i]);
+		else if (strcmp(args[i], "--tick-rate") == 0 && i + 1 < argc)
+			batch.game.tickRate = atoi(args[++i]);
+		else if (strcmp(args[i], "--max-minutes") == 0 && i + 1 < argc)
+			maxMinutes = atof(args[++i]);
+		else if (strcmp(args[i], "--stuck-after") == 0 && i + 1 < argc)
+			stuckSeconds = atof(args[++i]);
+		else if (strcmp(args[i], "--per-game") == 0)
+			perGame = true;
+		else
+		{
+			printf("Usage: %s [--level file.lvl] [--seeds first-last] [--replay file.rep] [--threads N] [--balls N] [--tick-rate N] [--max-minutes M] [--stuck-after S] [--per-game]\n", args[0]);
+			return 1;
+		}
+	}
+	if (threadCount < 1)
+		threadCount = 1;
+	if (batch.game.ballCount < 1 || batch.game.tickRate < 1 || maxMinutes <= 0.0 || stuckSeconds <= 0.0)
+	{
+		printf("The balls, the tick rate, the minutes and the seconds have to be positive\n");
+		return 1;
+	}
+
+	//Recorded keys are played as they are, with every seed, on the recording's set up
+	Replay replay;
+	if (replayPath != NULL)
+	{
+		if (!replay.load(replayPath))
+			return 1;
+		replay.applyTo(batch.game);
+		if (levelPath == NULL && !replay.level.empty())
+			levelPath = replay.level.c_str();
+		batch.replay = &replay;
+	}
+
+	LevelFile level;
+	if (levelPath != NULL)
+	{
+		if (!level.open(levelPath))
+			return 1;
+		batch.game.layout = &level.getLayout();
+	}
+
+	batch.maxSteps = (unsigned int)(maxMinutes * 60.0 * batch.game.tickRate);
+	batch.stuckSteps = (unsigned int)(stuckSeconds * batch.game.tickRate);
+
+	//Giving up would turn a stuck game into a lost one and hide it
+	batch.autopilot.giveUpAfter = 0;
+
+	//Every thread takes the next game nobody has started, and writes only its result
+	size_t gameCount = (size_t)(lastSeed - firstSeed) + 1;
+	std::vector<GameResult> results(gameCount);
+	std::atomic<size_t> nextGame(0);
+	auto work = [&]()
+	{
+		for (size_t game = nextGame++; game < gameCount; game = nextGame++)
+			results[game] = playGame(batch, firstSeed + (unsigned int)game);
+	};
+
+	if ((size_t)threadCount > gameCount)
+		threadCount = (int)gameCount;
+	auto start = std::chrono::steady_clock::now();
+	std::vector<std::thread> threads;
+	for (int i = 1; i < threadCount; i++)
+		threads.push_back(std::thread(work));
+	work();
+	for (size_t i = 0; i < threads.size(); i++)
+		threads[i].join();
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	//Add it all up in seed order, so the numbers and the hash are the same on any thread count
+	size_t cleared = 0, lost = 0, unfinished = 0, stuck = 0;
+	unsigned long long totalSteps = 0, totalBounces = 0, totalScore = 0;
+	std::vector<unsigned int> clearSteps;
+	uint64_t hash = HASH_START;
+	for (size_t i = 0; i < gameCount; i++)
+	{
+		const GameResult& result = results[i];
+		if (result.outcome == OUTCOME::CLEARED)
+		{
+			cleared++;
+			clearSteps.push_back(result.playSteps);
+		}
+		else if (result.outcome == OUTCOME::LOST)
+			lost++;
+		else if (result.outcome == OUTCOME::STUCK)
+			stuck++;
+		else
+			unfinished++;
+		totalSteps += result.playSteps;
+		totalBounces += result.bounces;
+		totalScore += result.score;
+		hash = hashValue(result.outcome, hash);
+		hash = hashValue(result.playSteps, hash);
+		hash = hashValue(result.bounces, hash);
+		hash = hashValue(result.score, hash);
+	}
+	std::sort(clearSteps.begin(), clearSteps.end());
+	double clearAverage = 0.0;
+	for (size_t i = 0; i < clearSteps.size(); i++)
+		clearAverage += clearSteps[i];
+	if (!clearSteps.empty())
+		clearAverage /= clearSteps.size();
+
+	printf("{\"batch\": \"%s\", \"level\": \"%s\", \"balls\": %d, \"tick_rate\": %d, \"first_seed\": %u, \"last_seed\": %u, \"threads\": %d, "
+		"\"stuck_after\": %.1f, \"games\": %zu, \"seconds\": %.3f, \"games_per_sec\": %.1f, \"play_steps_per_sec\": %.0f, "
+		"\"cleared\": %zu, \"lost\": %zu, \"stuck\": %zu, \"unfinished\": %zu, \"clear_rate\": %.4f, "
+		"\"steps_to_clear\": {\"min\": %u, \"avg\": %.1f, \"p50\": %u, \"p90\": %u, \"max\": %u}, "
+		"\"bounces_per_game\": %.2f, \"score_per_game\": %.1f, \"results_hash\": \"%016llx\"",
+		replayPath != NULL ? "replay" : "autopilot", levelPath != NULL ? levelPath : "classic", batch.game.ballCount, batch.game.tickRate,
+		firstSeed, lastSeed, threadCount, stuckSeconds, gameCount, seconds, gameCount / seconds, totalSteps / seconds,
+		cleared, lost, stuck, unfinished, (double)cleared / gameCount,
+		clearSteps.empty() ? 0 : clearSteps.front(), clearAverage, percentile(clearSteps, 0.5), percentile(clearSteps, 0.9),
+		clearSteps.empty() ? 0 : clearSteps.back(),
+		(double)totalBounces / gameCount, (double)totalScore / gameCount, (unsigned long long)hash);
+
+	if (perGame)
+	{
+		static const char* outcomes[] = { "cleared", "lost", "unfinished", "stuck" };
+		printf(", \"per_game\": [");
+		for (size_t i = 0; i < gameCount; i++)
+		{
+			const GameResult& result = results[i];
+			printf("%s{\"seed\": %u, \"outcome\": \"%s\", \"play_steps\": %u, \"bounces\": %u, \"score\": %d, \"bricks_left\": %d}",
+				i > 0 ? ", " : "", result.seed, outcomes[(int)result.outcome], result.playSteps, result.bounces, result.score, result.bricksLeft);
+		}
+		printf("]");
+	}
+	printf("}\n");
+	return 0;
+}
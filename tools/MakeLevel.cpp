@@ -0,0 +1,43 @@
+/*
+PROGRAM: Brick Breakers Using SDL
+PART: Level converter. Turns a level written in the text format into the
+      binary format the game maps, and can check a binary level by
+      loading it back.
+
+      g++ -O2 -I.. MakeLevel.cpp ../core/[A-Z]*.cpp -o makelevel
+      ./makelevel ../levels/classic.txt ../levels/classic.lvl
+      ./makelevel --check ../levels/classic.lvl
+*/
+#include <stdio.h>
+#include <string.h>
+
+#include "core/LevelFile.h"
+
+int main(int argc, char* args[])
+{
+	if (argc == 3 && strcmp(args[1], "--check") == 0)
+	{
+		LevelFile level;
+		if (!level.open(args[2]))
+			return 1;
+		const BrickLayout& layout = level.getLayout();
+		printf("%s: %zu bricks of %dx%d\n", args[2], layout.size(), layout.brickWidth, layout.brickHeight);
+		return 0;
+	}
+
+	if (argc != 3)
+	{
+		printf("Usage: %s <level.txt> <level.lvl>\n", args[0]);
+		printf("       %s --check <level.lvl>\n", args[0]);
+		return 1;
+	}
+
+	BrickLayout layout;
+	if (!loadLevelText(args[1], layout))
+		return 1;
+	if (!saveLevel(args[2], layout))
+		return 1;
+
+	printf("%s: %zu bricks written to %s\n", args[1], layout.size(), args[2]);
+	return 0;
+}
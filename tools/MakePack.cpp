@@ -0,0 +1,49 @@
+/*
+PROGRAM: Brick Breakers Using SDL
+PART: Asset packer. Puts the files the game loads into one pack, which
+      the game maps at start up instead of opening each file.
+
+      g++ -O2 -I.. MakePack.cpp ../core/[A-Z]*.cpp -o makepack
+      ./makepack assets.pack Player.bmp Bounce.wav "Patrick is good at making music.ogg" 04B_19__.ttf
+
+      The music is streamed either way, but packing the Ogg Vorbis version
+      (oggenc -q 4 "Patrick is good at making music.wav") keeps the pack
+      and the pages mapped for it a fraction of the size.
+*/
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#include "core/AssetPack.h"
+
+int main(int argc, char* args[])
+{
+	if (argc < 3)
+	{
+		printf("Usage: %s <pack> <file>...\n", args[0]);
+		return 1;
+	}
+
+	std::vector<std::string> files(args + 2, args + argc);
+	if (!saveAssetPack(args[1], files))
+		return 1;
+
+	//Read it back, so a pack that was written is one the game can open
+	AssetPack pack;
+	if (!pack.open(args[1]))
+		return 1;
+	for (size_t i = 0; i < files.size(); i++)
+	{
+		size_t slash = files[i].find_last_of("/\\");
+		std::string name = slash == std::string::npos ? files[i] : files[i].substr(slash + 1);
+		size_t size;
+		if (pack.find(name.c_str(), size) == NULL)
+		{
+			printf("%s is missing from %s\n", name.c_str(), args[1]);
+			return 1;
+		}
+		printf("%10zu %s\n", size, name.c_str());
+	}
+	printf("%zu assets packed into %s\n", pack.getEntryCount(), args[1]);
+	return 0;
+}
@@ -0,0 +1,100 @@
+/*
+PROGRAM: Brick Breakers Using SDL
+PART: Headless music memory check. Opens each music file the way the game
+      does, under SDL's dummy audio driver so no sound card is needed, and
+      prints a JSON line per file with the resident size before opening
+      it, once it is open and once it has played for a while. --mapped
+      reads the file out of a mapping the way the asset pack hands it
+      over, otherwise it is read from disk like a loose file.
+
+      g++ -O2 -I.. MusicMemory.cpp ../core/MappedFile.cpp ../core/ProcessMemory.cpp `pkg-config --cflags --libs sdl2 SDL2_mixer` -o musicmem
+      ./musicmem [--play-ms N] [--mapped] music.wav music.ogg
+*/
+#include <SDL.h>
+#include <SDL_mixer.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "core/MappedFile.h"
+#include "core/ProcessMemory.h"
+
+//Resident size in KB, for the report
+static double residentKb()
+{
+	return getResidentBytes() / 1024.0;
+}
+
+int main(int argc, char* args[])
+{
+	int playMs = 2000;
+	bool mapped = false;
+	int first = 1;
+	for (; first < argc; first++)
+	{
+		if (strcmp(args[first], "--play-ms") == 0 && first + 1 < argc)
+			playMs = atoi(args[++first]);
+		else if (strcmp(args[first], "--mapped") == 0)
+			mapped = true;
+		else
+			break;
+	}
+	if (first >= argc)
+	{
+		printf("Usage: %s [--play-ms N] [--mapped] music...\n", args[0]);
+		return 1;
+	}
+
+	//Nothing has to be heard, the decoder runs all the same
+	SDL_setenv("SDL_AUDIODRIVER", "dummy", 1);
+	if (SDL_Init(SDL_INIT_AUDIO) < 0)
+	{
+		printf("SDL could not initialize! SDL Error: %s\n", SDL_GetError());
+		return 1;
+	}
+	if ((Mix_Init(MIX_INIT_OGG) & MIX_INIT_OGG) == 0)
+		printf("Warning: no Ogg Vorbis decoder. SDL_mixer Error: %s\n", Mix_GetError());
+	if (Mix_OpenAudio(44100, MIX_DEFAULT_FORMAT, 2, 2048) < 0)
+	{
+		printf("SDL_mixer could not initialize! SDL_mixer Error: %s\n", Mix_GetError());
+		SDL_Quit();
+		return 1;
+	}
+
+	int failed = 0;
+	for (int i = first; i < argc; i++)
+	{
+		MappedFile file;
+		if (mapped && !file.open(args[i]))
+		{
+			printf("Unable to map %s!\n", args[i]);
+			failed++;
+			continue;
+		}
+
+		double before = residentKb();
+		SDL_RWops* source = mapped ? SDL_RWFromConstMem(file.getData(), (int)file.getSize()) : SDL_RWFromFile(args[i], "rb");
+		Mix_Music* music = Mix_LoadMUS_RW(source, 1);
+		if (music == NULL)
+		{
+			printf("Failed to load %s! SDL_mixer Error: %s\n", args[i], Mix_GetError());
+			failed++;
+			continue;
+		}
+		double loaded = residentKb();
+
+		Mix_PlayMusic(music, -1);
+		SDL_Delay(playMs);
+		double playing = residentKb();
+		Mix_HaltMusic();
+		Mix_FreeMusic(music);
+
+		printf("{\"music\":\"%s\",\"mapped\":%s,\"play_ms\":%d,\"resident_before_kb\":%.0f,\"loaded_kb\":%+.0f,\"playing_kb\":%+.0f}\n",
+			args[i], mapped ? "true" : "false", playMs, before, loaded - before, playing - before);
+	}
+
+	Mix_CloseAudio();
+	Mix_Quit();
+	SDL_Quit();
+	return failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,85 @@
+/*
+PROGRAM: Brick Breakers Using SDL
+PART: Headless replay. Plays a recorded game back without a window, as
+      fast as it goes or at the speed it was played, and checks that it
+      ends in the same state it was recorded in.
+
+      g++ -O2 -I.. Replay.cpp ../core/[A-Z]*.cpp -o replay
+      ./replay game.rep [--realtime] [--level other.lvl]
+*/
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+#include <thread>
+
+#include "core/Game.h"
+#include "core/LevelFile.h"
+#include "core/Replay.h"
+
+int main(int argc, char* args[])
+{
+	const char* path = NULL;
+	const char* levelPath = NULL;
+	bool realtime = false;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(args[i], "--realtime") == 0)
+			realtime = true;
+		else if (strcmp(args[i], "--level") == 0 && i + 1 < argc)
+			levelPath = args[++i];
+		else if (path == NULL && args[i][0] != '-')
+			path = args[i];
+		else
+			path = NULL, i = argc;
+	}
+	if (path == NULL)
+	{
+		printf("Usage: %s <replay> [--realtime] [--level <file.lvl>]\n", args[0]);
+		return 1;
+	}
+
+	Replay replay;
+	if (!replay.load(path))
+		return 1;
+
+	GameConfig config;
+	replay.applyTo(config);
+
+	//The level the game was recorded on, unless another copy of it was given
+	LevelFile level;
+	std::string levelName = levelPath != NULL ? levelPath : replay.level;
+	if (!levelName.empty())
+	{
+		if (!level.open(levelName.c_str()))
+			return 1;
+		config.layout = &level.getLayout();
+	}
+	if (hashLayout(config.layout != NULL ? *config.layout : classicLayout()) != replay.layoutHash)
+	{
+		printf("%s doesn't have the bricks the replay was recorded on\n", levelName.empty() ? "The classic level" : levelName.c_str());
+		return 1;
+	}
+
+	Game game(config);
+	ReplayCursor cursor(replay);
+	Input input;
+
+	auto start = std::chrono::steady_clock::now();
+	auto stepLength = std::chrono::duration<double>(game.getTickLength());
+	while (cursor.next(input))
+	{
+		game.step(input);
+
+		//Wait for the moment the step would have happened during play
+		if (realtime)
+			std::this_thread::sleep_until(start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(stepLength * cursor.getStep()));
+	}
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	uint64_t hash = hashState(game.getState());
+	bool same = hash == replay.finalHash;
+	printf("Replayed %u steps in %.3f s (%.0f steps/s), score %d\n", cursor.getStep(), seconds, cursor.getStep() / seconds, game.getState().score);
+	printf("Final state %016llx, recorded %016llx: %s\n", (unsigned long long)hash, (unsigned long long)replay.finalHash, same ? "identical" : "DIFFERENT");
+	return same ? 0 : 2;
+}
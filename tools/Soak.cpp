@@ -0,0 +1,89 @@
+/*
+PROGRAM: Brick Breakers Using SDL
+PART: Headless soak test. The autopilot plays game after game, menu to
+      play to the end screen and round again, with no frame limit, for as
+      long as asked. Every report window prints a JSON line with games per
+      second, step time drift and resident memory growth.
+
+      g++ -O2 -I.. Soak.cpp ../core/[A-Z]*.cpp -o soak
+      ./soak --seconds 3600 [--level file.lvl] [--balls N] [--seed N]
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+
+#include "core/Autopilot.h"
+#include "core/Game.h"
+#include "core/LevelFile.h"
+#include "core/SoakMonitor.h"
+
+int main(int argc, char* args[])
+{
+	double seconds = 60.0;
+	double reportEvery = 10.0;
+	unsigned long long maxGames = 0;
+	const char* levelPath = NULL;
+	GameConfig config;
+	AutopilotConfig pilot;
+
+	//Ten minutes of play and the autopilot lets the last balls go
+	pilot.giveUpAfter = 10 * 60 * DEFAULT_TICK_RATE;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(args[i], "--seconds") == 0 && i + 1 < argc)
+			seconds = atof(args[++i]);
+		else if (strcmp(args[i], "--games") == 0 && i + 1 < argc)
+			maxGames = strtoull(args[++i], NULL, 10);
+		else if (strcmp(args[i], "--report-every") == 0 && i + 1 < argc)
+			reportEvery = atof(args[++i]);
+		else if (strcmp(args[i], "--level") == 0 && i + 1 < argc)
+			levelPath = args[++i];
+		else if (strcmp(args[i], "--balls") == 0 && i + 1 < argc)
+			config.ballCount = atoi(args[++i]);
+		else if (strcmp(args[i], "--seed") == 0 && i + 1 < argc)
+			config.seed = pilot.seed = (unsigned int)strtoul(args[++i], NULL, 10);
+		else if (strcmp(args[i], "--give-up") == 0 && i + 1 < argc)
+			pilot.giveUpAfter = (unsigned int)strtoul(args[++i], NULL, 10);
+		else
+		{
+			printf("Usage: %s [--seconds S] [--games N] [--report-every S] [--level file.lvl] [--balls N] [--seed N] [--give-up steps]\n", args[0]);
+			return 1;
+		}
+	}
+	if (seconds <= 0.0 || config.ballCount < 1)
+	{
+		printf("The run has to be longer than 0 seconds and have at least one ball\n");
+		return 1;
+	}
+
+	LevelFile level;
+	if (levelPath != NULL)
+	{
+		if (!level.open(levelPath))
+			return 1;
+		config.layout = &level.getLayout();
+	}
+
+	Game game(config);
+	Autopilot autopilot(pilot);
+	SoakMonitor monitor(reportEvery);
+	monitor.start();
+
+	//Every step is a frame, there is nothing to draw and nothing to wait for
+	while (monitor.getElapsed() < seconds && (maxGames == 0 || monitor.getGames() < maxGames))
+	{
+		GAMEMODE mode = game.getState().mode;
+		auto before = std::chrono::steady_clock::now();
+		game.step(autopilot.next(game.getState()));
+		monitor.addFrame(std::chrono::duration<double>(std::chrono::steady_clock::now() - before).count());
+
+		GAMEMODE now = game.getState().mode;
+		if (mode == GAMEMODE::PLAY && now != GAMEMODE::PLAY)
+			monitor.addGame(now == GAMEMODE::WIN);
+		monitor.report(stdout);
+	}
+	monitor.finish(stdout);
+	return 0;
+}
@@ -0,0 +1,169 @@
+/*
+PROGRAM: Brick Breakers Using SDL
+PART: Headless versus player. Plays one side of a two player game over
+      UDP with the autopilot on the local paddle, in real time at the
+      tick rate, and can hold back and drop its own packets to try the
+      rollback against a bad connection. Prints one JSON object with the
+      rollbacks, how long they took against the step budget, the hash
+      checks and the hash of the last step, which both ends have to agree on.
+
+      g++ -O2 -I.. Versus.cpp ../core/[A-Z]*.cpp -o versus
+      ./versus --player 1 --port 7001 --peer 127.0.0.1:7002 [--latency ms] [--jitter ms] [--loss 0.05]
+      ./versus --player 2 --port 7002 --peer 127.0.0.1:7001 [--latency ms] [--jitter ms] [--loss 0.05]
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+#include <thread>
+
+#include "core/Autopilot.h"
+#include "core/Game.h"
+#include "core/VersusPeer.h"
+
+int main(int argc, char* args[])
+{
+	int player = 1;
+	int port = 0;
+	std::string peerHost;
+	int peerPort = 0;
+	uint32_t frames = 60 * DEFAULT_TICK_RATE;
+	int inputDelay = 2;
+	double timeout = 0.0;
+	unsigned int pilotSeed = 0;
+	LinkImpairment impairment;
+	GameConfig config;
+	AutopilotConfig pilot;
+
+	config.players = 2;
+	pilot.giveUpAfter = 10 * 60 * DEFAULT_TICK_RATE;
+
+	bool usage = false;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(args[i], "--player") == 0 && i + 1 < argc)
+			player = atoi(args[++i]);
+		else if (strcmp(args[i], "--port") == 0 && i + 1 < argc)
+			port = atoi(args[++i]);
+		else if (strcmp(args[i], "--peer") == 0 && i + 1 < argc)
+		{
+			std::string peer = args[++i];
+			size_t colon = peer.rfind(':');
+			if (colon == std::string::npos)
+				usage = true;
+			else
+			{
+				peerHost = peer.substr(0, colon);
+				peerPort = atoi(peer.c_str() + colon + 1);
+			}
+		}
+		else if (strcmp(args[i], "--frames") == 0 && i + 1 < argc)
+			frames = (uint32_t)strtoul(args[++i], NULL, 10);
+		else if (strcmp(args[i], "--delay") == 0 && i + 1 < argc)
+			inputDelay = atoi(args[++i]);
+		else if (strcmp(args[i], "--latency") == 0 && i + 1 < argc)
+			impairment.latencyMs = atof(args[++i]);
+		else if (strcmp(args[i], "--jitter") == 0 && i + 1 < argc)
+			impairment.jitterMs = atof(args[++i]);
+		else if (strcmp(args[i], "--loss") == 0 && i + 1 < argc)
+			impairment.loss = (float)atof(args[++i]);
+		else if (strcmp(args[i], "--balls") == 0 && i + 1 < argc)
+			config.ballCount = atoi(args[++i]);
+		else if (strcmp(args[i], "--seed") == 0 && i + 1 < argc)
+			config.seed = (unsigned int)strtoul(args[++i], NULL, 10);
+		else if (strcmp(args[i], "--pilot-seed") == 0 && i + 1 < argc)
+			pilotSeed = (unsigned int)strtoul(args[++i], NULL, 10);
+		else if (strcmp(args[i], "--timeout") == 0 && i + 1 < argc)
+			timeout = atof(args[++i]);
+		else
+			usage = true;
+	}
+	if (usage || (player != 1 && player != 2) || port <= 0 || peerPort <= 0 || frames == 0 || config.ballCount < 1)
+	{
+		printf("Usage: %s --player 1|2 --port N --peer host:port [--frames N] [--delay steps] [--latency ms] [--jitter ms] [--loss 0-1] [--balls N] [--seed N] [--pilot-seed N] [--timeout S]\n", args[0]);
+		return 1;
+	}
+
+	//Each end drops its own packets with its own luck, and its autopilot
+	// aims its own way unless told otherwise
+	impairment.seed = config.seed * 2 + player;
+	pilot.seed = pilotSeed != 0 ? pilotSeed : impairment.seed;
+	pilot.player = player - 1;
+
+	VersusPeer peer(config, player - 1, inputDelay);
+	if (!peer.open(port, peerHost.c_str(), peerPort))
+		return 1;
+	peer.setImpairment(impairment);
+	Autopilot autopilot(pilot);
+
+	//Long enough for the game and the other end to turn up
+	if (timeout <= 0.0)
+		timeout = frames / (double)config.tickRate * 2.0 + 30.0;
+
+	//Real time, like the game, so the latency means what it says
+	const auto tickLength = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1.0 / config.tickRate));
+	const auto start = std::chrono::steady_clock::now();
+	auto nextTick = start;
+	auto doneAt = start;
+	bool done = false;
+	uint64_t finalHash = 0;
+	uint64_t stallsBeforePeer = 0;
+	bool heard = false;
+
+	for (;;)
+	{
+		auto now = std::chrono::steady_clock::now();
+		double elapsed = std::chrono::duration<double>(now - start).count();
+
+		peer.update(autopilot.next(peer.getGame().getState()));
+
+		//Waiting for the other end to start doesn't count as stalling
+		if (!heard && peer.getSession().getRemoteConfirmed() > 0)
+		{
+			heard = true;
+			stallsBeforePeer = peer.getSession().getStats().stalls;
+		}
+
+		//The last step is final once both ends' keys for it are in, the
+		// game keeps going a little after so the other end gets there too
+		if (!done && peer.getSession().getConfirmedHash(frames - 1, finalHash))
+		{
+			done = true;
+			doneAt = now;
+		}
+		if (done && std::chrono::duration<double>(now - doneAt).count() > 1.0)
+			break;
+		if (elapsed > timeout)
+			break;
+
+		nextTick += tickLength;
+		std::this_thread::sleep_until(nextTick);
+	}
+
+	//How long the deepest rollback the session allows takes, next to the step budget
+	const RollbackStats& rollback = peer.getSession().getStats();
+	const VersusStats& versus = peer.getStats();
+	const LinkStats& link = peer.getLinkStats();
+	double fullRollbackMs = peer.getSession().timeRollback(MAX_ROLLBACK);
+	double budgetMs = 1000.0 / config.tickRate;
+	const GameState& state = peer.getGame().getState();
+
+	printf("{\"versus\": \"%s\", \"player\": %d, \"frames\": %u, \"finished\": %s, \"final_hash\": \"%016llx\", "
+		"\"latency_ms\": %.1f, \"jitter_ms\": %.1f, \"loss\": %.3f, \"input_delay\": %d, "
+		"\"steps\": %llu, \"stalls\": %llu, \"rollbacks\": %llu, \"resimulated_steps\": %llu, \"max_depth\": %d, "
+		"\"resimulate_avg_ms\": %.4f, \"resimulate_max_ms\": %.4f, \"rollback_%d_ms\": %.4f, \"step_budget_ms\": %.3f, "
+		"\"packets_sent\": %llu, \"packets_dropped\": %llu, \"packets_received\": %llu, \"bad_packets\": %llu, "
+		"\"hash_checks\": %llu, \"desyncs\": %llu, \"score\": [%d, %d]}\n",
+		done ? "ok" : "timed out", player, frames, done ? "true" : "false", (unsigned long long)finalHash,
+		impairment.latencyMs, impairment.jitterMs, impairment.loss, inputDelay,
+		(unsigned long long)rollback.steps, (unsigned long long)(rollback.stalls - stallsBeforePeer),
+		(unsigned long long)rollback.rollbacks, (unsigned long long)rollback.resimulatedSteps, rollback.maxDepth,
+		rollback.rollbacks > 0 ? rollback.resimulateMs / rollback.rollbacks : 0.0, rollback.maxResimulateMs,
+		MAX_ROLLBACK, fullRollbackMs, budgetMs,
+		(unsigned long long)link.sent, (unsigned long long)link.dropped, (unsigned long long)link.received,
+		(unsigned long long)versus.badPackets, (unsigned long long)versus.hashChecks, (unsigned long long)versus.desyncs,
+		state.score, state.score2);
+
+	return done && versus.desyncs == 0 ? 0 : 2;
+}
@@ -0,0 +1,66 @@
+#!/bin/sh
+#PROGRAM: Brick Breakers Using SDL
+#PART: Two stage profile guided build. Builds instrumented binaries,
+#      trains them with a scripted headless play session, builds again
+#      with the profiles and LTO, and compares the result with a plain
+#      -O2 build.
+#
+#      tools/pgo.sh [build directory, build-pgo by default]
+set -e
+
+SOURCE=$(cd "$(dirname "$0")/.." && pwd)
+OUT=${1:-"$SOURCE/build-pgo"}
+PROFILES="$OUT/profiles"
+JOBS=$(nproc 2>/dev/null || echo 4)
+
+#The training session: the same scripted games the benchmark plays, over
+# the brick and ball counts the game sees, from the classic wall to a
+# crowded one
+train()
+{
+	"$1/bench" --bricks 24 --balls 1 --ticks 20000
+	"$1/bench" --bricks 1000 --balls 100 --ticks 5000
+	"$1/bench" --bricks 10000 --balls 1000 --ticks 1000 --health 5
+	"$1/bench" --bricks 100000 --balls 10000 --ticks 100 --health 50
+	"$1/level_bench" > /dev/null
+}
+
+#What the builds get compared on
+measure()
+{
+	"$1/bench" --bricks 10000 --balls 1000 --ticks 3000 --health 5 | sed -n 's/.*"ticks_per_sec": \([0-9.]*\).*/\1/p'
+}
+
+#Both stages use one build directory, GCC finds its profiles by object path
+echo "== Instrumented build"
+rm -rf "$PROFILES"
+mkdir -p "$PROFILES"
+cmake -S "$SOURCE" -B "$OUT/pgo" -DCMAKE_BUILD_TYPE=Release -DBRICK_LTO=OFF -DBRICK_PGO=GENERATE -DBRICK_PGO_DIR="$PROFILES" > /dev/null
+cmake --build "$OUT/pgo" --clean-first -j "$JOBS" > /dev/null
+
+echo "== Training"
+train "$OUT/pgo" > /dev/null
+
+#Clang writes raw profiles that have to be merged first
+if ls "$PROFILES"/*.profraw > /dev/null 2>&1; then
+	llvm-profdata merge -output="$PROFILES/merged.profdata" "$PROFILES"/*.profraw
+fi
+
+#Training that wrote nothing would make the second stage a plain build
+if [ -z "$(find "$PROFILES" \( -name '*.gcda' -o -name 'merged.profdata' \) -print | head -n 1)" ]; then
+	echo "Training wrote no profiles to $PROFILES" >&2
+	exit 1
+fi
+
+echo "== Optimized build"
+cmake -S "$SOURCE" -B "$OUT/pgo" -DBRICK_LTO=ON -DBRICK_PGO=USE > /dev/null
+cmake --build "$OUT/pgo" --clean-first -j "$JOBS" > /dev/null
+
+echo "== Plain -O2 build"
+cmake -S "$SOURCE" -B "$OUT/plain" -DCMAKE_BUILD_TYPE=Release -DCMAKE_CXX_FLAGS_RELEASE="-O2 -DNDEBUG" -DBRICK_LTO=OFF -DBRICK_PGO=OFF > /dev/null
+cmake --build "$OUT/plain" -j "$JOBS" > /dev/null
+
+PLAIN=$(measure "$OUT/plain")
+OPTIMIZED=$(measure "$OUT/pgo")
+echo "ticks/sec, 10k bricks and 1k balls: plain -O2 $PLAIN, PGO+LTO $OPTIMIZED"
+echo "Optimized binaries are in $OUT/pgo"
@@ -0,0 +1,38 @@
+#!/bin/sh
+#PROGRAM: Brick Breakers Using SDL
+#PART: Plays a versus game between two headless processes over loopback,
+#      with the latency, jitter and loss given put on both ends' packets,
+#      and checks both ends finished on the same state.
+#
+#      tools/versus_loopback.sh [build directory] [--latency ms] [--jitter ms] [--loss 0-1] [--frames N] ...
+set -e
+
+SOURCE=$(cd "$(dirname "$0")/.." && pwd)
+BUILD="$SOURCE/build"
+case "$1" in
+	--*|"") ;;
+	*) BUILD=$1; shift ;;
+esac
+
+OUT=$(mktemp -d)
+trap 'rm -rf "$OUT"' EXIT
+
+#The autopilots aim differently, so both players' paddles send balls up
+"$BUILD/versus" --player 1 --port 7301 --peer 127.0.0.1:7302 --pilot-seed 11 "$@" > "$OUT/1.json" &
+FIRST=$!
+"$BUILD/versus" --player 2 --port 7302 --peer 127.0.0.1:7301 --pilot-seed 22 "$@" > "$OUT/2.json" || true
+wait $FIRST || true
+
+cat "$OUT/1.json" "$OUT/2.json"
+
+#Both ends have to have finished, without a desync, on the same hash
+HASH1=$(sed -n 's/.*"final_hash": "\([0-9a-f]*\)".*/\1/p' "$OUT/1.json")
+HASH2=$(sed -n 's/.*"final_hash": "\([0-9a-f]*\)".*/\1/p' "$OUT/2.json")
+if grep -q '"finished": true' "$OUT/1.json" && grep -q '"finished": true' "$OUT/2.json" \
+	&& grep -q '"desyncs": 0' "$OUT/1.json" && grep -q '"desyncs": 0' "$OUT/2.json" && [ "$HASH1" = "$HASH2" ]
+then
+	echo "== Both ends agree on $HASH1"
+else
+	echo "== The ends disagree"
+	exit 1
+fi